@@ -3,11 +3,16 @@
 #include <iostream>
 #include <map>
 #include <list>
+#include <vector>
 
 #include "component.hpp"
 #include "node.hpp"
 #include "circuit.hpp"
+#include "solver_backend.hpp"
+#include "low_rank_backend.hpp"
+#include "simulation_results.hpp"
 #include "Eigen/Dense"
+#include "Eigen/Sparse"
 
 using namespace Eigen;
 
@@ -16,30 +21,262 @@ typedef std::complex<float> cd;
 class MNAsolver {
     public:
         MNAsolver();
+        /*
+        Scalar is float, double, complex<float> or complex<double>.
+        Real matrices come from DC analysis and are solved without
+        complex arithmetic, double precision trades speed for
+        accuracy on stiff circuits. z holds the real source values.
+        */
+        template <typename Scalar>
+        void solveSteady(
+            const Matrix<Scalar, Dynamic, Dynamic>& A, 
+            const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z, 
+            float omega,
+            const std::map<std::string, int>& node_indexes, 
+            const std::map<std::string, int>& voltage_source_indexes, 
+            const std::map<std::string, int>& inductor_indexes
+        );
+        template <typename Scalar>
+        void solveSteady(
+            const SparseMatrix<Scalar>& A, 
+            const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z, 
+            float omega,
+            const std::map<std::string, int>& node_indexes, 
+            const std::map<std::string, int>& voltage_source_indexes, 
+            const std::map<std::string, int>& inductor_indexes
+        );
+        // fixed size and expression arguments
         void solveSteady(
             const MatrixXcf& A, 
-            const VectorXcf& z, 
+            const VectorXf& z, 
             float omega,
-            std::map<std::string, int> node_indexes, 
-            std::map<std::string, int> voltage_source_indexes, 
-            std::map<std::string, int> inductor_indexes
+            const std::map<std::string, int>& node_indexes, 
+            const std::map<std::string, int>& voltage_source_indexes, 
+            const std::map<std::string, int>& inductor_indexes
         );
-        const VectorXcf GetxVector() const { return x_; };
+        /*
+        Solves the system a circuit was constructed into, reading
+        its matrix, sources and indexes in place. The right-hand
+        side, the solution and the result maps are kept between
+        solves and overwritten, so solving the same circuit again
+        does not allocate them.
+        */
+        void solveSteady(const Circuit& circuit);
+
+        /*
+        A sparse circuit with several islands (see
+        Circuit::GetIslandCount) is solved by solveSteady(circuit)
+        as one system per island, on separate threads, each with
+        its own factorization kept for the next solve of the same
+        pattern. Low-rank updates and mixed precision apply to
+        whole circuits only.
+        */
+        void SetIslandSolving( bool islands ) { island_solving_ = islands; };
+        const bool GetIslandSolving() const { return island_solving_; };
+        // 0 uses every hardware thread
+        void SetThreadCount( int threads ) { threads_ = threads; };
+        // islands of the last solve, 1 if it was solved as one system
+        const int GetIslandCount() const { return island_count_; };
+        const bool IsSolved() const { return solved_; };
+
+        // backend used for the next solve, AUTO_BACKEND picks one per matrix
+        void SetBackend( SolverBackendType type ) { backend_type_ = type; };
+        SolverBackendType GetBackend() const { return backend_type_; };
+        // backend that was actually used in the last solve
+        SolverBackendType GetUsedBackend() const { return used_backend_; };
+        const std::string GetBackendName() const { return BackendName(GetUsedBackend()); };
+
+        // properties detected by Circuit::ConstructMatrices for the auto policy
+        void SetMatrixProperties( const MatrixProperties& properties ) { properties_ = properties; };
+
+        /*
+        Fill-reducing ordering of the sparse direct backends. Node
+        indexes follow the alphabetical order of node names, which
+        is an arbitrary elimination order, so the backends reorder
+        the matrix. AUTO_ORDERING keeps their own (COLAMD for
+        SparseLU, AMD for SimplicialLDLT).
+        */
+        void SetOrdering( OrderingType ordering ) { ordering_ = ordering; };
+        OrderingType GetOrdering() const { return ordering_; };
+        // computes fill statistics of every new sparse analysis, listed with the results
+        void SetFillStatistics( bool enabled ) { fill_statistics_ = enabled; };
+        const FillStatistics& GetFillStatistics() const { return statistics_; };
+
+        // true if the last sparse solve reused the cached symbolic analysis
+        const bool ReusedAnalysis() const { return reused_analysis_; };
+
+        /*
+        Low-rank updates of sparse direct solves. The factorization
+        of the previous solve is kept and a matrix that differs from
+        it in at most max_rank rows is solved with a Woodbury update
+        instead of being factored again, see LowRankBackend. Meant
+        for editing one component at a time, zero turns it off.
+        */
+        void SetLowRankUpdates( int max_rank ) { max_rank_ = max_rank; };
+        const int GetLowRankUpdates() const { return max_rank_; };
+        // true if the last solve applied an update, and its number of rows
+        const bool IsLowRankUpdated() const { return low_rank_updated_; };
+        const int GetUpdateRank() const { return update_rank_; };
+
+        /*
+        Mixed precision mode. Double precision matrices are factored
+        in single precision, which halves the memory and bandwidth
+        of the factorization, and the solution is refined with
+        residuals computed in double until the relative residual is
+        below the tolerance.
+        */
+        void SetMixedPrecision( bool mixed ) { mixed_precision_ = mixed; };
+        const bool GetMixedPrecision() const { return mixed_precision_; };
+        void SetRefinement( double tolerance, int max_steps ) { refinement_tolerance_ = tolerance; max_refinement_steps_ = max_steps; };
+        // refinement of the last solve, zero steps if it was not refined
+        const int GetRefinementSteps() const { return refinement_.steps; };
+        const double GetResidual() const { return refinement_.residual; };
+        const bool IsRefined() const { return refined_; };
+
+        /*
+        Settings of the iterative backends (CONJUGATE_GRADIENT,
+        BICGSTAB_* and GMRES_*). The tolerance is on the relative
+        residual. Each solve starts from the previous solution of
+        the same scalar type, so a sequence of similar solves (a
+        sweep or edited component values) converges in fewer
+        iterations.
+        */
+        void SetIterativeTolerance( double tolerance, int max_iterations ) { iterative_tolerance_ = tolerance; max_iterations_ = max_iterations; };
+        // iterations and relative residual of the last iterative solve
+        const bool IsIterative() const { return iterative_; };
+        const int GetIterations() const { return iterations_; };
+        const double GetIterativeError() const { return iterative_error_; };
+        // wall time of the last solve including factorization, seconds
+        const double GetSolveTime() const { return solve_time_; };
+
+        const VectorXcf GetxVector() const { return x_.cast<cd>(); };
+        // solution in the precision of a double precision solve
+        const VectorXcd& GetxVectorDouble() const { return x_; };
+        // true if the last solve was a real DC solve
+        const bool IsReal() const { return real_; };
         const VectorXcf GetiVector() const { return i_; };
-        const std::map<std::string, cd> GetNodeVoltages() const { return node_voltages_; };
-        const std::map<std::string, cd> GetVoltageSourceCurrents() const { return voltage_source_currents_; };
+        // solution of the last solve by index, a single column at omega, with the currents of setCurrents
+        const SimulationResults& GetResults() const { return results_; };
+        const std::map<std::string, cd>& GetNodeVoltages() const { return node_voltages_; };
+        const std::map<std::string, cd>& GetVoltageSourceCurrents() const { return voltage_source_currents_; };
 
-        void setCurrents(const std::list<std::shared_ptr<Component>> components, float omega);
+        void setCurrents(const std::list<std::shared_ptr<Component>>& components, float omega);
+        // currents of passive components by name, after setCurrents
+        const std::map<std::string, cd> GetComponentCurrents() const;
         
         std::ostream& resultListed(std::ostream &out);
 
 
     private:
-        VectorXcf x_;
+        template <typename Scalar>
+        struct BackendCache {
+            std::unique_ptr<SolverBackend<Scalar>> backend;
+            std::uint64_t fingerprint = 0;  // pattern the backend was analyzed for
+            OrderingType ordering = AUTO_ORDERING;  // ordering the backend was created with
+            int max_rank = 0;  // low-rank updates the backend was created with
+            Matrix<Scalar, Dynamic, 1> guess;  // last solution, starting point of iterative backends
+            Matrix<Scalar, Dynamic, 1> rhs;  // z in the scalar type, reused between solves
+            Matrix<Scalar, Dynamic, 1> solution;
+            std::vector<std::unique_ptr<SolverBackend<Scalar>>> islands;  // one backend per island
+            std::uint64_t islands_fingerprint = 0;  // pattern of the whole matrix the islands were analyzed for
+            SolverBackendType islands_type = AUTO_BACKEND;  // backend type asked for
+            OrderingType islands_ordering = AUTO_ORDERING;
+        };
+
+        // cache of the scalar type, one per instantiation
+        template <typename Scalar>
+        BackendCache<Scalar>& cache();
+
+        // solves into x_ without setting the results
+        template <typename Scalar>
+        void solveSystem(
+            const Matrix<Scalar, Dynamic, Dynamic>& A,
+            const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z
+        );
+        template <typename Scalar>
+        void solveSystem(
+            const SparseMatrix<Scalar>& A,
+            const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z
+        );
+
+        template <typename Scalar>
+        void solveMixed(
+            const SparseMatrix<Scalar>& A,
+            const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z
+        );
+
+        template <typename Scalar>
+        void setSolution(
+            bool factored,
+            BackendCache<Scalar>& cache,
+            const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z
+        );
+
+        template <typename Scalar>
+        bool solveIslands(
+            const SparseMatrix<Scalar>& A,
+            const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z,
+            const std::vector<int>& islands,
+            int count
+        );
+
+        template <typename Scalar>
+        SolverBackendType resolveBackend(const SparseMatrix<Scalar>& A, std::uint64_t fingerprint) const;
+
+        template <typename Scalar>
+        bool factorize(BackendCache<Scalar>& cache, const Matrix<Scalar, Dynamic, Dynamic>& A);
+        template <typename Scalar>
+        bool factorize(BackendCache<Scalar>& cache, const SparseMatrix<Scalar>& A);
+
+        // circuit, when given, also indexes the results by node and component id
+        void setResults(
+            float omega,
+            const std::map<std::string, int>& node_indexes, 
+            const std::map<std::string, int>& voltage_source_indexes, 
+            const std::map<std::string, int>& inductor_indexes,
+            const Circuit* circuit = nullptr
+        );
+
+        SolverBackendType backend_type_ = AUTO_BACKEND;
+        MatrixProperties properties_;
+        BackendCache<float> float_cache_;
+        BackendCache<double> double_cache_;
+        BackendCache<cd> complex_cache_;
+        BackendCache<std::complex<double>> complex_double_cache_;
+        SolverBackendType used_backend_ = AUTO_BACKEND;
+        bool reused_analysis_ = false;
+        int max_rank_ = 0;
+        bool low_rank_updated_ = false;
+        int update_rank_ = 0;
+        OrderingType ordering_ = AUTO_ORDERING;
+        bool fill_statistics_ = false;
+        bool has_statistics_ = false;  // statistics_ describe the matrix of the last solve
+        FillStatistics statistics_;
+        bool mixed_precision_ = false;
+        double refinement_tolerance_ = REFINEMENT_TOLERANCE;
+        int max_refinement_steps_ = MAX_REFINEMENT_STEPS;
+        bool refined_ = false;
+        RefinementResult refinement_;
+        double iterative_tolerance_ = ITERATIVE_TOLERANCE;
+        int max_iterations_ = ITERATIVE_MAX_ITERATIONS;
+        bool iterative_ = false;
+        int iterations_ = 0;
+        double iterative_error_ = 0;
+        double solve_time_ = 0;
+        bool island_solving_ = true;
+        int threads_ = 0;
+        int island_count_ = 1;
+
+        bool solved_ = false;
+        bool real_ = false;  // last solve was real, x_ has no imaginary part
+        VectorXcd x_;  // widest scalar type, holds the solution of any solve
         VectorXcf i_;
+        SimulationResults results_;
         std::map<std::string, cd> node_voltages_;
         std::map<std::string, cd> voltage_source_currents_;
-        std::map<std::string, cd> passive_component_currents_;
+        std::map<std::string, cd> passive_component_currents_;  // DC inductors, from the solution
+        std::vector<std::string> branch_names_;  // components of setCurrents
+        ArrayXcd branch_currents_;
 };
 
 std::ostream &operator<<(std::ostream& out, const MNAsolver& solver);
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "circuit.hpp"
+#include "simulation_results.hpp"
+#include "solver_backend.hpp"
+#include "Eigen/Dense"
+#include "Eigen/Sparse"
+
+using namespace Eigen;
+
+typedef std::complex<float> cd;
+
+enum SweepSpacing {
+    LINEAR_SWEEP,
+    DECADE_SWEEP,
+    OCTAVE_SWEEP
+};
+
+
+class ACSweep {
+
+    /*
+    Steady state AC analysis over a range of angular frequencies.
+
+    The circuit is indexed once and every frequency point has the
+    same sparsity pattern, so each worker thread analyzes the
+    pattern once and only refactors numerically per point. Points
+    are handed out to the workers from a shared counter.
+
+    Results are stored with one column per frequency point, so the
+    solution of a single point is contiguous in memory, see
+    SimulationResults. The branch currents of the passive
+    components are computed by each worker right after its point
+    is solved, into the current block of the column.
+
+    With an iterative backend every point starts from the
+    solution of the nearest frequency solved so far, by any
+    worker, which is close to it on a fine sweep. The points
+    are handed out in order, so that is usually an adjacent one.
+
+    In mixed precision mode every point is assembled in double,
+    factored in single precision and refined to double accuracy
+    (see SolveRefined).
+    */
+
+    public:
+        ACSweep(float start, float stop, int points, SweepSpacing spacing = DECADE_SWEEP);
+
+        static std::vector<float> SweepPoints(float start, float stop, int points, SweepSpacing spacing);
+
+        void SetThreadCount( int threads ) { threads_ = threads; };
+        void SetBackend( SolverBackendType type ) { backend_type_ = type; };
+        void SetMixedPrecision( bool mixed ) { mixed_precision_ = mixed; };
+        void SetIterativeTolerance( double tolerance, int max_iterations ) { iterative_tolerance_ = tolerance; max_iterations_ = max_iterations; };
+
+        bool Run(Circuit& circuit);
+
+        const bool IsSolved() const { return solved_; };
+        const std::vector<float>& GetOmegas() const { return omegas_; };
+        // refinement steps summed over every point, and the largest final residual
+        const int GetRefinementSteps() const { return refinement_steps_; };
+        const double GetMaxResidual() const { return max_residual_; };
+        // iterations of an iterative backend summed over every point
+        const int GetIterations() const { return iterations_; };
+        const SimulationResults& GetResults() const { return results_; };
+        Map<const MatrixXcf> GetxMatrix() const { return results_.GetValues(); };
+        const MatrixXcf GetNodeVoltages() const;
+        const MatrixXcf GetVoltageSourceCurrents() const;
+        const VectorXcf GetNodeResponse(const std::string& node) const;
+        // current of a resistor, capacitor or inductor at every point, zero for sources
+        const VectorXcf GetComponentResponse(const std::string& component) const;
+        const std::map<std::string, int>& GetNodeIndexes() const { return node_indexes_; };
+        const std::map<std::string, int>& GetVoltageSourceIndexes() const { return voltage_source_indexes_; };
+
+        std::ostream& resultListed(std::ostream &out);
+
+    private:
+        std::vector<float> omegas_;
+        int threads_ = 0;  // 0 uses every hardware thread
+        SolverBackendType backend_type_ = AUTO_BACKEND;
+        bool mixed_precision_ = false;
+        double iterative_tolerance_ = ITERATIVE_TOLERANCE;
+        int max_iterations_ = ITERATIVE_MAX_ITERATIONS;
+        int iterations_ = 0;
+        bool solved_ = false;
+        int refinement_steps_ = 0;
+        double max_residual_ = 0;
+
+        SimulationResults results_;  // column k is the MNA solution at omegas_[k]
+        std::map<std::string, int> node_indexes_;
+        std::map<std::string, int> voltage_source_indexes_;
+};
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <memory>
+
 #include "node.hpp"
 #include "component.hpp"
+#include "waveform.hpp"
 
 
 class ActiveComponent : public Component {
@@ -10,6 +13,9 @@ class ActiveComponent : public Component {
     Active components generate power into the circuit.
     For example: independent and dependent voltage and
     current sources.
+
+    A source may have a waveform, which gives its value in
+    transient analysis. DC and AC analyses use GetValue.
     */
 
     public:
@@ -21,7 +27,14 @@ class ActiveComponent : public Component {
         );
 
         ComponentClass GetClass() const;
+
+        float GetValueAt(float time) const;
+
+        const std::shared_ptr<Waveform> GetWaveform() const { return waveform_; };
+
+        void SetWaveform(std::shared_ptr<Waveform> waveform) { waveform_ = waveform; };
     
     private:
         float freq_;
+        std::shared_ptr<Waveform> waveform_;
 };
\ No newline at end of file
@@ -4,15 +4,33 @@
 #include <iostream>
 #include <map>
 #include <algorithm>
+#include <unordered_map>
+#include <vector>
 
 #include "component.hpp"
+#include "component_store.hpp"
 #include "node.hpp"
+#include "solver_backend.hpp"
+#include "stamp.hpp"
 #include "Eigen/Dense"
+#include "Eigen/Sparse"
 
 using namespace Eigen;
 
 typedef std::complex<float> cd;
 
+// circuits with more MNA unknowns than this are assembled as sparse matrices
+#define SPARSE_ASSEMBLY_THRESHOLD 64
+
+// sources are given as amplitudes, AC analysis uses rms values, 1 / sqrt(2)
+#define RMS_SCALE 0.70710678118654752
+
+enum AssemblyMode {
+    AUTO_ASSEMBLY,
+    DENSE_ASSEMBLY,
+    SPARSE_ASSEMBLY
+};
+
 class Circuit {
 public:
     Circuit() {}
@@ -20,34 +38,229 @@ public:
     const std::list<std::shared_ptr<Component>>& GetComponents() const;
 
     const float GetOmega() const { return omega_; };
-    const MatrixXcf GetAMatrix() const { return A_; };
-    const VectorXf GetZMatrix() const { return z_;};    
+    // A in complex form, converted from the storage it was assembled in
+    const MatrixXcf GetAMatrix() const;
+    const SparseMatrix<cd> GetSparseAMatrix() const;
+    /*
+    The assembled system itself, without copies. The real
+    matrices are only valid when IsReal() and the complex ones
+    when not, the dense ones only when the circuit was assembled
+    densely.
+    */
+    const MatrixXf& GetRealAMatrix() const { return A_real_; };
+    const SparseMatrix<float>& GetRealSparseAMatrix() const { return A_real_sparse_; };
+    const MatrixXcf& GetComplexAMatrix() const { return A_; };
+    const SparseMatrix<cd>& GetComplexSparseAMatrix() const { return A_sparse_; };
+    const VectorXf& GetZMatrix() const { return z_;};    
+    // stamp matrices are kept in double, callers cast them to the precision they solve in
+    const SparseMatrix<double>& GetGMatrix() const { return G_; };
+    const SparseMatrix<double>& GetCMatrix() const { return C_; };
+    const SparseMatrix<double>& GetGammaMatrix() const { return Gamma_; };
+    const VectorXd& GetSourceVector() const { return s_; };
+    // of the full A, GetReducedMatrixProperties describes the reduced system
+    const MatrixProperties GetMatrixProperties() const { return properties_; };
+    std::uint64_t GetTopologyFingerprint() const { return properties_.fingerprint; };
  
-    const std::map<std::string, int> GetNodeIndexes() const { return node_indexes_; };
-    const std::map<std::string, int> GetVoltageSourceIndexes() const { return voltage_source_indexes_; };
-    const std::map<std::string, int> GetInductorIndexes() const { return inductor_indexes_; };
+    const std::map<std::string, int>& GetNodeIndexes() const { return node_indexes_; };
+    const std::map<std::string, int>& GetVoltageSourceIndexes() const { return voltage_source_indexes_; };
+    const std::map<std::string, int>& GetInductorIndexes() const { return inductor_indexes_; };
+    // MNA row of each node id, -1 for ground and removed nodes
+    const std::vector<int>& GetNodeRows() const { return node_rows_; };
+    // ids given to component objects so far, every id is below it
+    int GetComponentIdCount() const { return component_ids_; };
+    int GetDimension() const { return dimension_; };
 
     void SetOmega( float omega ) { omega_ = omega; };
 
+    AssemblyMode GetAssemblyMode() const { return assembly_mode_; };
+    void SetAssemblyMode( AssemblyMode mode ) { assembly_mode_ = mode; };
+    bool IsSparse() const;
+    // DC circuits are assembled and solved without complex arithmetic
+    bool IsReal() const { return real_; };
+
     const std::shared_ptr<Node> AddNode(const std::string& node_name);
     const std::shared_ptr<Node> AddNode();
-    void RemoveNode(const std::string& node_name);
+    // false if the node does not exist or a component is connected to it
+    bool RemoveNode(const std::string& node_name);
     void RemoveUnnecessaryNodes();
     void AddComponent(std::shared_ptr<Component> component);
+    // restamps only the edited components when the topology did not change
     void ConstructMatrices();
+    /*
+    Restamps the component values after they changed, keeping the
+    matrices of the last ConstructMatrices, for parameter sweeps
+    and Monte Carlo loops. Omega may change between AC
+    frequencies. Adding or removing components or moving between
+    DC and AC needs ConstructMatrices, which this falls back to
+    when the circuit does not match the plan.
+    */
+    void UpdateValues();
+    // Scalar is float, double, complex<float> or complex<double>
+    template <typename Scalar>
+    void AssembleMatrices(float omega, SparseMatrix<Scalar>& A, Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z) const;
+    template <typename Real>
+    void AssembleSources(float time, Matrix<Real, Dynamic, 1>& s) const;
+    std::vector<float> GetBreakpoints(float stop) const;
     void RemoveComponent(std::shared_ptr<Component> component);
-    std::map<std::string, std::shared_ptr<Node>> GetNodes() { return nodes_; };
+    /*
+    Elements are components kept in the structure of arrays store,
+    for very large netlists. They are stamped like components but
+    are not in GetComponents(), so only the currents of voltage
+    sources and DC inductors among them are reported, and only
+    if they are named.
+    */
+    ComponentHandle AddElement(ComponentType type, const std::string& name, float value,
+        std::shared_ptr<Node> input, std::shared_ptr<Node> output);
+    bool RemoveElement(ComponentHandle handle) { return elements_.Remove(handle); };
+    ComponentStore& GetElements() { return elements_; };
+    const ComponentStore& GetElements() const { return elements_; };
+    // nodes by name, built for I/O
+    std::map<std::string, std::shared_ptr<Node>> GetNodes() const;
+    const std::shared_ptr<Node> GetNode(int id) const;
     bool HasGround();
-    bool Solveable() const;
+    /*
+    False also when part of the circuit has no path to ground.
+    For a transient time step capacitors are a path too, so a
+    node reached only through capacitors is solveable there,
+    though not at DC.
+    */
+    bool Solveable(bool transient = false) const;
+    /*
+    Islands are the parts of the circuit that are connected to
+    each other only through ground. Their rows of A do not
+    couple, so A is block diagonal over them and every island
+    can be solved as its own system. Current sources do not
+    couple rows and capacitors do not at DC, so they join no
+    islands. An island that nothing connects to ground has a
+    singular block, its nodes are reported as floating.
+    */
+    int GetIslandCount() const { return island_count_; };
+    // island of each MNA row, of each row of the reduced system when IsReduced()
+    const std::vector<int>& GetIslands() const { return islands_; };
+    const std::vector<std::string>& GetFloatingNodes() const { return floating_nodes_; };
+    // nodes without a path to ground even through capacitors
+    const std::vector<std::string>& GetTransientFloatingNodes() const { return transient_floating_nodes_; };
+
+    /*
+    Topological pre-reduction of DC circuits. Nodes shorted to
+    each other by DC inductors share one row, nodes shorted to
+    ground by them are ground, and the node of a voltage source
+    whose other terminal is at ground is eliminated by
+    substituting its known voltage. The rows of those inductor
+    and source currents go with them, so inductor heavy netlists
+    shrink a lot. The stamp matrices, A, z and the indexes keep
+    every unknown, the reduced system is a separate pair of
+    GetReducedAMatrix and GetReducedZMatrix with its own matrix
+    properties, and the islands are those of it. ExpandSolution maps a
+    solution of the reduced system back, with the eliminated
+    currents found from the current law. Off by default, AC
+    circuits are never reduced.
+    */
+    void SetTopologyReduction( bool reduce ) { reduce_topology_ = reduce; };
+    const bool GetTopologyReduction() const { return reduce_topology_; };
+    // true if the last ConstructMatrices also built the reduced system
+    bool IsReduced() const { return reduced_; };
+    // valid when IsReduced(), always sparse
+    const SparseMatrix<float>& GetReducedAMatrix() const { return A_reduced_; };
+    const VectorXf& GetReducedZMatrix() const { return z_reduced_; };
+    // those of the full A when the circuit is not reduced
+    const MatrixProperties GetReducedMatrixProperties() const { return reduced_properties_; };
+    // rows of A, n + m + l when it is not reduced
+    int GetReducedDimension() const { return reduced_ ? reduced_dimension_ : dimension_; };
+    // solution of A x = z to the n + m + l unknowns of the indexes
+    void ExpandSolution(const VectorXd& reduced, VectorXd& x) const;
 
 private:
-    MatrixXcf A_;
+    std::vector<bool> UsedNodes() const;
+    void BuildMatrices();
+    void FindIslands();
+    void FindReduction();
+    void BuildStampMatrices();
+    void ReduceMatrices();
+    VectorXd FixedVoltages() const;
+    void StampValues(StampContext& context);
+    void FinishMatrices();
+    bool MatchesPlan() const;
+    bool RestampChanges();
+    void UpdateEntries(const std::vector<int>& entries, const std::vector<int>& rows);
+
+    // frequency independent stamps, A(w) = G + jwC + Gamma / (jw)
+    SparseMatrix<double> G_;
+    SparseMatrix<double> C_;
+    SparseMatrix<double> Gamma_;
+    VectorXd s_;  // source amplitudes
+    std::vector<SourceStamp> source_stamps_;  // rows of s_ each source adds to
+    VectorXd s_elements_;  // constant part of s_ from the element store
+    std::vector<int> assembly_plan_;  // value array offset of each stamp entry, in stamp order
+    bool plan_dc_ = false;  // the plan was built with DC indexing
+    int plan_revision_ = -1;  // element store revisions stamped
+    int plan_value_revision_ = -1;
+
+    struct StampRecord {
+        const Component* component = nullptr;  // null when not stamped
+        size_t start = 0;  // first entry of the component in the plan
+        float value = 0;  // value it was stamped with
+    };
+    std::vector<StampRecord> stamp_records_;  // by component id
+    std::shared_ptr<ChangeLog> changes_ = std::make_shared<ChangeLog>();
+
+    MatrixXcf A_;  // only filled when the circuit is assembled densely
+    SparseMatrix<cd> A_sparse_;  // empty for DC, where A = G_
+    MatrixXf A_real_;  // dense DC matrix
+    SparseMatrix<float> A_real_sparse_;  // DC matrix, G in single precision
     VectorXf z_;
+    MatrixProperties properties_;
+    MatrixProperties reduced_properties_;
 
     float omega_ = 0;
+    int dimension_ = 0;  // n + m + l of the last ConstructMatrices
+    bool real_ = false;  // last ConstructMatrices was for DC
+    float matrices_omega_ = 0;  // omega A and z were formed at
+    bool matrices_sparse_ = false;
+    AssemblyMode assembly_mode_ = AUTO_ASSEMBLY;
 
-    std::map<std::string, std::shared_ptr<Node>> nodes_;
+    /*
+    Nodes are indexed by their id, removed nodes leave an empty
+    slot. Names are only looked up when nodes are added by name
+    or results are reported, assembly goes through the ids and
+    the MNA indexes stored in the nodes and components.
+    */
+    std::vector<std::shared_ptr<Node>> nodes_;
+    std::unordered_map<std::string, int> node_ids_;
+    int auto_name_ = 0;  // next candidate for AddNode() names
+    int component_ids_ = 0;  // components added so far
     std::list<std::shared_ptr<Component>> components_;
+    ComponentStore elements_;
+    std::vector<int> node_rows_;  // MNA row of each node id, -1 for ground and removed nodes
+    std::vector<int> element_rows_[COMPONENT_TYPE_COUNT];  // branch rows of stored inductors and voltage sources
+    std::vector<int> islands_;  // island of each row, by FindIslands
+    int island_count_ = 0;
+    std::vector<std::string> floating_nodes_;
+    std::vector<std::string> transient_floating_nodes_;
+
+    struct FixedNode {
+        int row;  // of the node
+        int source;  // row of the grounded voltage source, its value is in s_
+        double sign;  // -1 when the source is turned towards ground
+    };
+    struct EliminatedBranch {
+        int branch;  // row of the inductor or source current
+        int node;  // row whose current law gives the current, leaf side of the branch
+        int parent;  // row of the other terminal, -1 for ground
+        double coefficient;  // of the current in the law of node
+        double parent_coefficient;
+    };
+    bool reduce_topology_ = false;
+    bool reduction_attempted_ = false;  // last ConstructMatrices tried to reduce, it gives up on some circuits
+    bool reduced_ = false;  // last ConstructMatrices reduced A and z
+    int reduced_dimension_ = 0;
+    std::vector<int> reduced_index_;  // row and column of each unknown in the reduced A, -1 if eliminated
+    std::vector<FixedNode> fixed_nodes_;
+    std::vector<EliminatedBranch> eliminated_;  // leaves first, in the order the currents are found
+    SparseMatrix<double> G_reduced_;
+    SparseMatrix<float> A_reduced_;
+    VectorXf z_reduced_;
+    std::vector<int> reduction_plan_;  // offset in G_reduced_ of each entry of G_, -1 if dropped
 
     std::map<std::string, int> node_indexes_;
     std::map<std::string, int> voltage_source_indexes_;
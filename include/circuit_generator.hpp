@@ -0,0 +1,45 @@
+#pragma once
+
+#include "circuit.hpp"
+
+
+/*
+Synthetic n x n power distribution grid for benchmarking the
+solvers on large resistive meshes. Neighbouring nodes N<i>_<j>
+are connected by resistors, every node draws a load current to
+ground and the four corners are supply pads, Norton equivalents
+of the supply voltage behind the pad resistance. The circuit has
+no voltage sources, so its G matrix is symmetric positive
+definite with n^2 unknowns and about 5 n^2 nonzeros.
+
+With elements the grid is built in the circuit's element store
+instead of as component objects, which is how netlists with
+millions of elements should be held.
+*/
+Circuit ResistorGrid(
+    int n,
+    float resistance = 1,
+    float load = 1e-3,
+    float supply = 1,
+    float pad_resistance = 0.1,
+    bool elements = false
+);
+
+/*
+nx x ny x nz resistor mesh, two dimensional when nz is 1, for
+benchmarking the solvers that partition the circuit graph.
+Neighbouring nodes N<i>_<j>_<k> are connected by resistors and,
+when capacitance is not zero, every node has a capacitor to
+ground, which makes it an RC mesh at AC. A voltage source drives
+the first corner and the opposite corner is tied to ground
+through a resistor, so there is one current unknown and
+nx ny nz node voltages.
+*/
+Circuit ResistorMesh(
+    int nx,
+    int ny,
+    int nz = 1,
+    float resistance = 1,
+    float capacitance = 0,
+    float supply = 1
+);
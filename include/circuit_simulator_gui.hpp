@@ -20,6 +20,7 @@
 #include "gui_components/gui_current_source.hpp"
 
 #include "circuit.hpp"
+#include "MNAsolver.hpp"
 
 #define GRID_SIZE 20
 
@@ -73,7 +74,13 @@ class CircuitSimulatorGUI : public sf::RenderWindow {
         void Reset();
     
     private:
+        // solves circuit_ after ConstructMatrices
+        void SolveSteady();
+        // why circuit_ is not Solveable, names the floating nodes
+        void ReportUnsolveable();
+
         Circuit circuit_;
+        MNAsolver solver_;  // kept between simulations to reuse its factorization
         int resistors_ = 0;
         int inductors_ = 0;
         int capacitors_ = 0;
@@ -93,6 +100,8 @@ class CircuitSimulatorGUI : public sf::RenderWindow {
         std::shared_ptr<GUIGround> addingGround_ = nullptr;  // pointer to ground being added
         std::shared_ptr<GUIWire> addingWire_ = nullptr;  // pointer to wire being added
         float zoom_ = 1;  // current zoom of view
+        bool doublePrecision_ = false;  // solve steady state analyses in double precision
+        bool mixedPrecision_ = false;  // factor in single precision, refine in double
         sf::Cursor cursor_;
         sf::VertexArray helper_lines_ = sf::VertexArray(sf::Lines, 4);
         imgui_addons::ImGuiFileBrowser file_dialog_;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "node.hpp"
 
@@ -24,6 +25,20 @@ enum TerminalType {
 };
 
 
+struct ChangeLog {
+
+    /*
+    Edits made to the components of a circuit since its matrices
+    were last constructed. The circuit shares it with every
+    component it holds, so a value edit costs a push_back and
+    the circuit restamps only the components listed here.
+    */
+
+    std::vector<int> values;  // ids of components whose value changed
+    bool topology = true;  // components added, removed or reconnected
+};
+
+
 class Component {
 
     /*
@@ -49,18 +64,41 @@ class Component {
 
         void ConnectNodeToTerminal(std::shared_ptr<Node> node, TerminalType terminal);
 
+        // dense id given by the circuit when the component is added
+        int GetId() const;
+
+        void SetId(int id);
+
+        // branch current row of a voltage source or DC inductor, -1 if it has none
+        int GetIndex() const;
+
+        void SetIndex(int index);
+
+        // log of the circuit the component reports its edits to
+        void SetChangeLog(std::shared_ptr<ChangeLog> changes);
+
         virtual float GetValue() const = 0;
 
         virtual void SetValue(float newval) = 0;
 
+        // value at a time instant of transient analysis
+        virtual float GetValueAt(float time) const { return GetValue(); };
+
         virtual ComponentClass GetClass() const = 0;
 
         virtual ComponentType GetType() const = 0;
 
         friend std::ostream &operator<<(std::ostream &out, const Component& c);
 
+    protected:
+        // subclasses call this when SetValue changes the value
+        void ValueChanged();
+
     private:
         std::string name_;
         std::shared_ptr<Node> output_;
         std::shared_ptr<Node> input_;
+        int id_ = -1;
+        int index_ = -1;
+        std::shared_ptr<ChangeLog> changes_;
 };
\ No newline at end of file
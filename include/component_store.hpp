@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "component.hpp"
+
+// number of ComponentType values, one array set per type
+#define COMPONENT_TYPE_COUNT 5
+
+
+struct ComponentHandle {
+
+    /*
+    Stable reference to a component in a ComponentStore. The
+    generation changes when the slot is reused, so a handle to
+    a removed component stays invalid.
+    */
+
+    int slot = -1;
+    int generation = 0;
+
+    bool operator==(const ComponentHandle& other) const { return slot == other.slot && generation == other.generation; };
+    bool operator!=(const ComponentHandle& other) const { return !(*this == other); };
+};
+
+
+class ComponentStore {
+
+    /*
+    Components stored as structure of arrays instead of objects.
+    Every component type has contiguous arrays of values and
+    terminal node ids, so assembly is a linear scan over plain
+    arrays without virtual calls, and a million resistors take
+    28 bytes each, the value, node ids and slot of the entry and
+    the slot itself, instead of a heap allocated object.
+
+    Removal moves the last entry of the type into the freed
+    position, O(1), and handles go through a slot table that
+    follows these moves. Names are optional and kept in a side
+    table, they are only needed to report the currents of
+    voltage sources and DC inductors. Source values are
+    constant, sources with waveforms are components.
+    */
+
+    public:
+        struct Arrays {
+            std::vector<float> values;
+            std::vector<int> outputs;  // node ids of the output terminals
+            std::vector<int> inputs;  // node ids of the input terminals
+            std::vector<int> slots;  // slot of each entry, for handles
+        };
+
+        ComponentHandle Add(ComponentType type, float value, int input, int output, const std::string& name = "");
+        bool Remove(ComponentHandle handle);
+        bool Contains(ComponentHandle handle) const;
+        void Clear();
+        void Reserve(ComponentType type, size_t count);
+
+        ComponentType GetType(ComponentHandle handle) const { return slots_[handle.slot].type; };
+        // position of the component in the arrays of its type, changes on removal
+        int GetPosition(ComponentHandle handle) const { return slots_[handle.slot].position; };
+        float GetValue(ComponentHandle handle) const;
+        void SetValue(ComponentHandle handle, float value);
+        int GetNode(ComponentHandle handle, TerminalType terminal) const;
+        const std::string GetName(ComponentHandle handle) const;
+        // name of an entry by type and position, empty if it has none
+        const std::string GetName(ComponentType type, int position) const;
+
+        const Arrays& Get(ComponentType type) const { return arrays_[type]; };
+        // counters of structural and value edits, for callers caching stamps
+        int GetRevision() const { return revision_; };
+        int GetValueRevision() const { return value_revision_; };
+        size_t Size(ComponentType type) const { return arrays_[type].values.size(); };
+        size_t Size() const;
+
+    private:
+        struct Slot {
+            ComponentType type = RESISTOR;
+            int position = -1;  // -1 when free
+            int generation = 0;
+        };
+
+        Arrays arrays_[COMPONENT_TYPE_COUNT];
+        std::vector<Slot> slots_;
+        std::vector<int> free_slots_;
+        std::unordered_map<int, std::string> names_;  // by slot
+        int revision_ = 0;
+        int value_revision_ = 0;
+};
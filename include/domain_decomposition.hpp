@@ -0,0 +1,326 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "solver_backend.hpp"
+#include "ordering.hpp"
+#include "Eigen/Dense"
+#include "Eigen/Sparse"
+
+using namespace Eigen;
+
+template <typename Scalar>
+class SchurComplementBackend : public SolverBackend<Scalar> {
+
+    /*
+    Domain decomposition of A into subdomains that only meet at
+    a small interface. With the interior unknowns of every
+    subdomain numbered first and the interface Γ last, A is
+
+        | A_11           A_1Γ |
+        |       A_22     A_2Γ |
+        |            ... ...  |
+        | A_Γ1  A_Γ2 ... A_ΓΓ |
+
+    and eliminating the interiors leaves the Schur complement
+
+        S = A_ΓΓ - sum_i A_Γi A_ii^-1 A_iΓ
+
+    on the interface. Analyze partitions the graph of A with
+    PartitionGraph, nested dissection style. Rows with a zero
+    diagonal, the rows of voltage sources and DC inductors, are
+    moved to the interface so that every interior block can be
+    factored on its own.
+
+    Factorize factors the interior blocks on separate threads,
+    each with its own reordered SparseLU, and every thread forms
+    the part of S from its subdomain, one interface column of
+    A_ii^-1 A_iΓ at a time. S is then factored with SparseLU.
+    The subdomains of a mesh are meshes themselves, on which AMD
+    gives much sparser factors than the COLAMD of SparseLU, and
+    every interface column is a solve with them.
+    Solve eliminates the interiors in parallel, solves for the
+    interface and substitutes back into the interiors:
+
+        y_i = A_ii^-1 b_i
+        S x_Γ = b_Γ - sum_i A_Γi y_i
+        x_i = y_i - A_ii^-1 A_iΓ x_Γ
+
+    The interface is factored serially, so the speedup depends
+    on it staying small next to the subdomains, as it does on
+    meshes.
+
+    Experimental: SelectBackend never picks it. It has only
+    been timed on one core, where it is about twice as slow as
+    SparseLU on 2D meshes and only faster on 3D ones, whose
+    factors fill in more. Whether the parallel factorization
+    pays off on several cores is not measured yet.
+    */
+
+    public:
+        typedef SolverBackend<Scalar> Base;
+        typedef typename Base::DenseMatrixType DenseMatrixType;
+        typedef typename Base::SparseMatrixType SparseMatrixType;
+        typedef typename Base::VectorType VectorType;
+
+        // 0 domains or threads uses every hardware thread, at least two domains
+        SchurComplementBackend(int domains = 0, int threads = 0, OrderingType ordering = AMD_ORDERING)
+            : ordering_(ordering) {
+            int hardware = std::max(1, int(std::thread::hardware_concurrency()));
+            domain_count_ = domains > 0 ? domains : std::max(2, hardware);
+            threads_ = threads > 0 ? threads : hardware;
+        }
+
+        bool Compute(const DenseMatrixType& A) {
+            return Compute(SparseMatrixType(A.sparseView()));
+        }
+
+        bool Compute(const SparseMatrixType& A) {
+            return Analyze(A) && Factorize(A);
+        }
+
+        bool Analyze(const SparseMatrixType& A) {
+            const int n = A.rows();
+            std::vector<int> part = PartitionGraph(A, domain_count_);
+            for ( int i = 0; i < n; i++ ) {
+                if ( A.coeff(i, i) == Scalar(0) ) {
+                    part[i] = -1;
+                }
+            }
+
+            n_ = n;
+            domains_.clear();
+            for ( int d = 0; d < domain_count_; d++ ) {
+                domains_.push_back(std::unique_ptr<Domain>(new Domain()));
+            }
+            domain_of_.assign(n, -1);
+            local_.assign(n, -1);
+            interface_.clear();
+            for ( int i = 0; i < n; i++ ) {
+                if ( part[i] < 0 ) {
+                    local_[i] = interface_.size();
+                    interface_.push_back(i);
+                } else {
+                    domain_of_[i] = part[i];
+                    local_[i] = domains_[part[i]]->rows.size();
+                    domains_[part[i]]->rows.push_back(i);
+                }
+            }
+
+            // interface unknowns each subdomain is coupled to
+            std::vector<int> seen(interface_.size(), -1);
+            for ( int col = 0; col < n; col++ ) {
+                for ( typename SparseMatrixType::InnerIterator it(A, col); it; ++it ) {
+                    int d = domain_of_[it.row()] >= 0 ? domain_of_[it.row()] : domain_of_[col];
+                    int boundary = domain_of_[it.row()] >= 0 ? col : it.row();
+                    if ( d < 0 || domain_of_[boundary] >= 0 ) continue;
+                    std::vector<int>& adjacent = domains_[d]->adjacent;
+                    if ( seen[local_[boundary]] != d ) {
+                        std::vector<int>::iterator found = std::lower_bound(adjacent.begin(), adjacent.end(), local_[boundary]);
+                        if ( found == adjacent.end() || *found != local_[boundary] ) {
+                            adjacent.insert(found, local_[boundary]);
+                        }
+                        seen[local_[boundary]] = d;
+                    }
+                }
+            }
+            return true;
+        }
+
+        bool Factorize(const SparseMatrixType& A) {
+            if ( A.rows() != n_ || A.cols() != n_ ) {
+                return false;
+            }
+            const int m = interface_.size();
+
+            // position of each interface unknown among those of a subdomain
+            std::vector<std::vector<int>> position(domains_.size());
+            for ( size_t d = 0; d < domains_.size(); d++ ) {
+                position[d].assign(m, -1);
+                for ( size_t k = 0; k < domains_[d]->adjacent.size(); k++ ) {
+                    position[d][domains_[d]->adjacent[k]] = k;
+                }
+            }
+
+            std::vector<std::vector<Triplet<Scalar>>> interior(domains_.size());
+            std::vector<std::vector<Triplet<Scalar>>> coupling(domains_.size());
+            std::vector<std::vector<Triplet<Scalar>>> back(domains_.size());
+            std::vector<Triplet<Scalar>> schur;
+            for ( int col = 0; col < n_; col++ ) {
+                for ( typename SparseMatrixType::InnerIterator it(A, col); it; ++it ) {
+                    int row = it.row();
+                    int d_row = domain_of_[row];
+                    int d_col = domain_of_[col];
+                    if ( d_row >= 0 && d_col >= 0 ) {
+                        if ( d_row != d_col ) {
+                            if ( it.value() != Scalar(0) ) {
+                                return false;  // not the pattern that was analyzed
+                            }
+                            continue;
+                        }
+                        interior[d_row].push_back(Triplet<Scalar>(local_[row], local_[col], it.value()));
+                    } else if ( d_row >= 0 ) {
+                        coupling[d_row].push_back(Triplet<Scalar>(local_[row], position[d_row][local_[col]], it.value()));
+                    } else if ( d_col >= 0 ) {
+                        back[d_col].push_back(Triplet<Scalar>(position[d_col][local_[row]], local_[col], it.value()));
+                    } else {
+                        schur.push_back(Triplet<Scalar>(local_[row], local_[col], it.value()));
+                    }
+                }
+            }
+
+            std::atomic<bool> failed(false);
+            ForEachDomain([&](int d) {
+                Domain& domain = *domains_[d];
+                const int size = domain.rows.size();
+                const int adjacent = domain.adjacent.size();
+                domain.interior.resize(size, size);
+                domain.interior.setFromTriplets(interior[d].begin(), interior[d].end());
+                domain.coupling.resize(size, adjacent);
+                domain.coupling.setFromTriplets(coupling[d].begin(), coupling[d].end());
+                domain.back.resize(adjacent, size);
+                domain.back.setFromTriplets(back[d].begin(), back[d].end());
+                domain.contribution.setZero(adjacent, adjacent);
+                if ( size == 0 ) {
+                    return;
+                }
+
+                if ( !domain.lu ) {
+                    domain.lu = CreateBackend<Scalar>(SPARSE_LU, ordering_);
+                    domain.lu->Analyze(domain.interior);
+                }
+                if ( !domain.lu->Factorize(domain.interior) ) {
+                    failed = true;
+                    return;
+                }
+                // A_Γi A_ii^-1 A_iΓ
+                for ( int j = 0; j < adjacent; j++ ) {
+                    VectorType w = domain.lu->Solve(VectorType(domain.coupling.col(j)));
+                    domain.contribution.col(j) = domain.back * w;
+                }
+            });
+            if ( failed ) {
+                return false;
+            }
+
+            for ( auto const& domain : domains_ ) {
+                const std::vector<int>& adjacent = domain->adjacent;
+                for ( size_t j = 0; j < adjacent.size(); j++ ) {
+                    for ( size_t i = 0; i < adjacent.size(); i++ ) {
+                        if ( domain->contribution(i, j) != Scalar(0) ) {
+                            schur.push_back(Triplet<Scalar>(adjacent[i], adjacent[j], -domain->contribution(i, j)));
+                        }
+                    }
+                }
+                domain->contribution.resize(0, 0);
+            }
+            SparseMatrixType S(m, m);
+            S.setFromTriplets(schur.begin(), schur.end());
+            if ( m > 0 ) {
+                interface_lu_.compute(S);
+                if ( interface_lu_.info() != Success ) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        VectorType Solve(const VectorType& z) const {
+            const int m = interface_.size();
+            std::vector<VectorType> y(domains_.size());
+            ForEachDomain([&](int d) {
+                const Domain& domain = *domains_[d];
+                if ( domain.rows.empty() ) return;
+                VectorType b(domain.rows.size());
+                for ( size_t i = 0; i < domain.rows.size(); i++ ) {
+                    b(i) = z(domain.rows[i]);
+                }
+                y[d] = domain.lu->Solve(b);
+            });
+
+            VectorType g(m);
+            for ( int k = 0; k < m; k++ ) {
+                g(k) = z(interface_[k]);
+            }
+            for ( size_t d = 0; d < domains_.size(); d++ ) {
+                if ( domains_[d]->rows.empty() ) continue;
+                VectorType t = domains_[d]->back * y[d];
+                for ( size_t k = 0; k < domains_[d]->adjacent.size(); k++ ) {
+                    g(domains_[d]->adjacent[k]) -= t(k);
+                }
+            }
+            VectorType interface = m > 0 ? VectorType(interface_lu_.solve(g)) : VectorType(g);
+
+            VectorType x(n_);
+            for ( int k = 0; k < m; k++ ) {
+                x(interface_[k]) = interface(k);
+            }
+            ForEachDomain([&](int d) {
+                const Domain& domain = *domains_[d];
+                if ( domain.rows.empty() ) return;
+                VectorType boundary(domain.adjacent.size());
+                for ( size_t k = 0; k < domain.adjacent.size(); k++ ) {
+                    boundary(k) = interface(domain.adjacent[k]);
+                }
+                VectorType correction = domain.lu->Solve(VectorType(domain.coupling * boundary));
+                for ( size_t i = 0; i < domain.rows.size(); i++ ) {
+                    x(domain.rows[i]) = y[d](i) - correction(i);
+                }
+            });
+            return x;
+        }
+
+        SolverBackendType GetType() const { return SCHUR_COMPLEMENT; }
+
+        OrderingType GetOrdering() const { return ordering_; }
+
+        int GetDomainCount() const { return domain_count_; }
+        // unknowns of the separators and zero diagonal rows
+        int GetInterfaceSize() const { return interface_.size(); }
+
+    private:
+        struct Domain {
+            std::vector<int> rows;  // interior unknowns
+            std::vector<int> adjacent;  // interface unknowns coupled to the interior, sorted
+            SparseMatrixType interior;  // A_ii
+            SparseMatrixType coupling;  // A_iΓ, columns of adjacent
+            SparseMatrixType back;  // A_Γi, rows of adjacent
+            DenseMatrixType contribution;  // A_Γi A_ii^-1 A_iΓ while factoring
+            std::unique_ptr<Base> lu;  // of A_ii, analyzed with the partition
+        };
+
+        // runs work for every subdomain, on up to threads_ threads
+        void ForEachDomain(const std::function<void(int)>& work) const {
+            const int count = domains_.size();
+            std::atomic<int> next(0);
+            auto worker = [&]() {
+                for ( int d = next++; d < count; d = next++ ) {
+                    work(d);
+                }
+            };
+            int threads = std::max(1, std::min(threads_, count));
+            std::vector<std::thread> pool;
+            for ( int t = 1; t < threads; t++ ) {
+                pool.push_back(std::thread(worker));
+            }
+            worker();
+            for ( auto& thread : pool ) {
+                thread.join();
+            }
+        }
+
+        int domain_count_;
+        int threads_;
+        OrderingType ordering_;  // of the interior blocks
+        int n_ = 0;
+        std::vector<std::unique_ptr<Domain>> domains_;
+        std::vector<int> domain_of_;  // subdomain of each unknown, -1 on the interface
+        std::vector<int> local_;  // index of each unknown in its subdomain or the interface
+        std::vector<int> interface_;
+        SparseLU<SparseMatrixType, COLAMDOrdering<int>> interface_lu_;  // of S
+};
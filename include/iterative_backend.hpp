@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "solver_backend.hpp"
+#include "multigrid.hpp"
+#include "Eigen/Sparse"
+#include "unsupported/Eigen/IterativeSolvers"
+
+using namespace Eigen;
+
+
+template <typename Scalar>
+class IncompleteLU0 {
+
+    /*
+    ILU(0) preconditioner, an incomplete LU factorization that
+    keeps the sparsity pattern of A (no fill-in). Usable as the
+    preconditioner of Eigen's iterative solvers.
+
+    MNA matrices have a zero diagonal on voltage source and DC
+    inductor rows. The structural diagonal is added to the
+    pattern, elimination of the node columns before those rows
+    fills it in, and a pivot that is still zero is replaced by
+    a small multiple of the row norm, as IncompleteLUT does.
+    */
+
+    public:
+        typedef SparseMatrix<Scalar, RowMajor> FactorType;
+        typedef Matrix<Scalar, Dynamic, 1> VectorType;
+
+        IncompleteLU0() {}
+
+        template <typename MatrixType>
+        explicit IncompleteLU0(const MatrixType& A) { compute(A); }
+
+        Index rows() const { return lu_.rows(); }
+        Index cols() const { return lu_.cols(); }
+
+        template <typename MatrixType>
+        IncompleteLU0& analyzePattern(const MatrixType&) { return *this; }
+
+        template <typename MatrixType>
+        IncompleteLU0& factorize(const MatrixType& A) {
+            const int n = A.rows();
+            FactorType identity(n, n);
+            identity.setIdentity();
+            lu_ = FactorType(A) + Scalar(0) * identity;
+            lu_.makeCompressed();
+
+            const int* outer = lu_.outerIndexPtr();
+            const int* inner = lu_.innerIndexPtr();
+            Scalar* values = lu_.valuePtr();
+
+            diagonal_.assign(n, -1);
+            std::vector<int> position(n, -1);  // index of each column in the current row
+
+            for ( int i = 0; i < n; i++ ) {
+                for ( int p = outer[i]; p < outer[i + 1]; p++ ) {
+                    position[inner[p]] = p;
+                    if ( inner[p] == i ) {
+                        diagonal_[i] = p;
+                    }
+                }
+
+                // IKJ elimination restricted to the pattern of row i
+                for ( int p = outer[i]; p < outer[i + 1] && inner[p] < i; p++ ) {
+                    int k = inner[p];
+                    values[p] /= values[diagonal_[k]];
+                    for ( int q = diagonal_[k] + 1; q < outer[k + 1]; q++ ) {
+                        int j = position[inner[q]];
+                        if ( j >= 0 ) {
+                            values[j] -= values[p] * values[q];
+                        }
+                    }
+                }
+
+                if ( values[diagonal_[i]] == Scalar(0) ) {
+                    typename NumTraits<Scalar>::Real norm = lu_.row(i).norm();
+                    values[diagonal_[i]] = std::sqrt(NumTraits<Scalar>::epsilon()) * (norm > 0 ? norm : 1);
+                }
+
+                for ( int p = outer[i]; p < outer[i + 1]; p++ ) {
+                    position[inner[p]] = -1;
+                }
+            }
+            return *this;
+        }
+
+        template <typename MatrixType>
+        IncompleteLU0& compute(const MatrixType& A) {
+            analyzePattern(A);
+            return factorize(A);
+        }
+
+        template <typename Rhs>
+        VectorType solve(const MatrixBase<Rhs>& b) const {
+            VectorType x = lu_.template triangularView<UnitLower>().solve(b);
+            lu_.template triangularView<Upper>().solveInPlace(x);
+            return x;
+        }
+
+        ComputationInfo info() const { return Success; }
+
+    private:
+        FactorType lu_;
+        std::vector<int> diagonal_;  // position of the diagonal in each row of lu_
+};
+
+
+template <typename Solver, SolverBackendType Type>
+class IterativeBackend : public SolverBackend<typename Solver::MatrixType::Scalar> {
+
+    /*
+    Krylov subspace solver with a preconditioner. Compute only
+    builds the preconditioner, so it is much cheaper than a
+    factorization, and each solve iterates until the relative
+    residual is below the tolerance or the iteration cap is hit.
+    Eigen's solvers keep a reference to the matrix, so the
+    backend holds its own copy.
+    */
+
+    public:
+        typedef SolverBackend<typename Solver::MatrixType::Scalar> Base;
+
+        IterativeBackend() { SetTolerance(ITERATIVE_TOLERANCE, ITERATIVE_MAX_ITERATIONS); }
+
+        bool Compute(const typename Base::DenseMatrixType& A) {
+            return Compute(typename Base::SparseMatrixType(A.sparseView()));
+        }
+
+        bool Compute(const typename Base::SparseMatrixType& A) {
+            matrix_ = A;
+            solver_.compute(matrix_);
+            return solver_.info() == Success;
+        }
+
+        bool Analyze(const typename Base::SparseMatrixType& A) {
+            matrix_ = A;
+            solver_.analyzePattern(matrix_);
+            return true;
+        }
+
+        bool Factorize(const typename Base::SparseMatrixType& A) {
+            matrix_ = A;
+            solver_.factorize(matrix_);
+            return solver_.info() == Success;
+        }
+
+        typename Base::VectorType Solve(const typename Base::VectorType& z) const {
+            return solver_.solve(z);
+        }
+
+        typename Base::VectorType SolveWithGuess(
+                const typename Base::VectorType& z,
+                const typename Base::VectorType& guess
+            ) const {
+            if ( guess.rows() != z.rows() ) {
+                return Solve(z);
+            }
+            return solver_.solveWithGuess(z, guess);
+        }
+
+        SolverBackendType GetType() const { return Type; }
+
+        bool IsIterative() const { return true; }
+
+        void SetTolerance( double tolerance, int max_iterations ) {
+            solver_.setTolerance(tolerance);
+            solver_.setMaxIterations(max_iterations);
+        }
+
+        bool Converged() const { return solver_.info() == Success; }
+        int GetIterations() const { return solver_.iterations(); }
+        double GetError() const { return solver_.error(); }
+
+    private:
+        typename Base::SparseMatrixType matrix_;
+        Solver solver_;
+};
+
+
+template <typename Scalar>
+using ConjugateGradientBackend = IterativeBackend<
+    ConjugateGradient<SparseMatrix<Scalar>, Lower | Upper, IncompleteCholesky<Scalar, Lower, AMDOrdering<int>>>,
+    CONJUGATE_GRADIENT>;
+template <typename Scalar>
+using BiCGSTABILU0Backend = IterativeBackend<BiCGSTAB<SparseMatrix<Scalar>, IncompleteLU0<Scalar>>, BICGSTAB_ILU0>;
+template <typename Scalar>
+using BiCGSTABILUTBackend = IterativeBackend<BiCGSTAB<SparseMatrix<Scalar>, IncompleteLUT<Scalar>>, BICGSTAB_ILUT>;
+template <typename Scalar>
+using GMRESILU0Backend = IterativeBackend<GMRES<SparseMatrix<Scalar>, IncompleteLU0<Scalar>>, GMRES_ILU0>;
+template <typename Scalar>
+using GMRESILUTBackend = IterativeBackend<GMRES<SparseMatrix<Scalar>, IncompleteLUT<Scalar>>, GMRES_ILUT>;
+template <typename Scalar>
+using MultigridBackend = IterativeBackend<MultigridSolver<Scalar>, MULTIGRID>;
+template <typename Scalar>
+using ConjugateGradientAMGBackend = IterativeBackend<
+    ConjugateGradient<SparseMatrix<Scalar>, Lower | Upper, AlgebraicMultigrid<Scalar>>,
+    CONJUGATE_GRADIENT_AMG>;
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "solver_backend.hpp"
+#include "Eigen/Dense"
+#include "Eigen/Sparse"
+
+using namespace Eigen;
+
+// default number of changed rows applied as an update before refactoring
+#define LOW_RANK_MAX_RANK 16
+
+// an update is refactored once its residual grows this much over the factorization's
+#define LOW_RANK_RESIDUAL_GROWTH 100
+
+
+template <typename Scalar>
+class LowRankBackend : public SolverBackend<Scalar> {
+
+    /*
+    Sherman-Morrison-Woodbury updates on top of a direct backend.
+    The backend keeps the factors of A0, the matrix it factored
+    last. A new matrix A of the same pattern that differs from A0
+    in k rows R is
+
+        A = A0 + E_R D
+
+    with E_R the columns of the identity at R and D the k changed
+    rows of A - A0. Editing one resistor changes the two rows of
+    its nodes. Then
+
+        A^-1 b = y - W S^-1 D y,  y = A0 \ b,  W = A0 \ E_R,
+        S = I + D W
+
+    so instead of refactoring, Factorize forms the k x k matrix S.
+    The columns of W are kept per row while the row stays in the
+    update, so tuning one component solves for them once and then
+    every solve costs one solve with the factors and O(k n).
+
+    The factors are redone when more than max_rank rows changed,
+    when S is close to singular, or when the residual of a probe
+    solve grows past LOW_RANK_RESIDUAL_GROWTH times that of the
+    factorization, since the update loses accuracy as A drifts
+    away from A0.
+    */
+
+    public:
+        typedef SolverBackend<Scalar> Base;
+        typedef typename Base::DenseMatrixType DenseMatrixType;
+        typedef typename Base::SparseMatrixType SparseMatrixType;
+        typedef typename Base::VectorType VectorType;
+        typedef typename NumTraits<Scalar>::Real Real;
+
+        LowRankBackend(std::unique_ptr<Base> backend, int max_rank = LOW_RANK_MAX_RANK)
+            : backend_(std::move(backend)), max_rank_(max_rank) { }
+
+        bool Compute(const DenseMatrixType& A) {
+            return Compute(SparseMatrixType(A.sparseView()));
+        }
+
+        bool Compute(const SparseMatrixType& A) {
+            return Refactored(A, backend_->Compute(A));
+        }
+
+        bool Analyze(const SparseMatrixType& A) {
+            factored_ = false;
+            return backend_->Analyze(A);
+        }
+
+        bool Factorize(const SparseMatrixType& A) {
+            if ( Update(A) ) {
+                return true;
+            }
+            return Refactored(A, backend_->Factorize(A));
+        }
+
+        VectorType Solve(const VectorType& z) const {
+            VectorType y = backend_->Solve(z);
+            if ( rows_.empty() ) {
+                return y;
+            }
+            VectorType t = update_ * y;
+            return y - columns_ * capacitance_.solve(t);
+        }
+
+        SolverBackendType GetType() const { return backend_->GetType(); }
+
+        OrderingType GetOrdering() const { return backend_->GetOrdering(); }
+
+        // true if the last Factorize applied an update instead of refactoring
+        bool IsUpdated() const { return updated_; }
+
+        // number of rows of the current update, zero right after a factorization
+        int GetRank() const { return rows_.size(); }
+
+    private:
+        bool Refactored(const SparseMatrixType& A, bool factored) {
+            base_ = A;
+            base_.makeCompressed();
+            factored_ = factored;
+            updated_ = false;
+            rows_.clear();
+            cached_.clear();
+            if ( factored_ ) {
+                base_residual_ = ProbeResidual(A);
+            }
+            return factored_;
+        }
+
+        bool Update(const SparseMatrixType& A) {
+            updated_ = false;
+            const int n = A.rows();
+            if ( !factored_ || max_rank_ <= 0 || !A.isCompressed() || base_.rows() != n
+                    || base_.nonZeros() != A.nonZeros()
+                    || !std::equal(A.outerIndexPtr(), A.outerIndexPtr() + n + 1, base_.outerIndexPtr())
+                    || !std::equal(A.innerIndexPtr(), A.innerIndexPtr() + A.nonZeros(), base_.innerIndexPtr()) ) {
+                return false;
+            }
+
+            // rows where A differs from the factored matrix
+            std::vector<int> position(n, -1);
+            std::vector<int> rows;
+            const Scalar* values = A.valuePtr();
+            const Scalar* base_values = base_.valuePtr();
+            const int* inner = A.innerIndexPtr();
+            for ( int p = 0; p < A.nonZeros(); p++ ) {
+                if ( values[p] != base_values[p] && position[inner[p]] < 0 ) {
+                    if ( int(rows.size()) == max_rank_ ) {
+                        return false;
+                    }
+                    position[inner[p]] = rows.size();
+                    rows.push_back(inner[p]);
+                }
+            }
+
+            const int k = rows.size();
+            std::vector<Triplet<Scalar>> triplets;
+            for ( int col = 0; col < n; col++ ) {
+                for ( int p = A.outerIndexPtr()[col]; p < A.outerIndexPtr()[col + 1]; p++ ) {
+                    if ( position[inner[p]] >= 0 && values[p] != base_values[p] ) {
+                        triplets.push_back(Triplet<Scalar>(position[inner[p]], col, values[p] - base_values[p]));
+                    }
+                }
+            }
+            update_.resize(k, n);
+            update_.setFromTriplets(triplets.begin(), triplets.end());
+
+            // W = A0 \ E_R, columns of rows already in the update are kept
+            std::map<int, VectorType> cached;
+            columns_.resize(n, k);
+            for ( int j = 0; j < k; j++ ) {
+                auto it = cached_.find(rows[j]);
+                if ( it != cached_.end() ) {
+                    cached[rows[j]] = it->second;
+                } else {
+                    VectorType unit = VectorType::Unit(n, rows[j]);
+                    cached[rows[j]] = backend_->Solve(unit);
+                }
+                columns_.col(j) = cached[rows[j]];
+            }
+            cached_.swap(cached);
+            rows_ = rows;
+
+            if ( k > 0 ) {
+                DenseMatrixType S = DenseMatrixType::Identity(k, k) + update_ * columns_;
+                capacitance_.compute(S);
+                if ( !(capacitance_.rcond() > NumTraits<Real>::dummy_precision()) ) {
+                    return false;
+                }
+            }
+
+            double residual = ProbeResidual(A);
+            if ( !(residual <= LOW_RANK_RESIDUAL_GROWTH * base_residual_ + NumTraits<Real>::dummy_precision()) ) {
+                return false;
+            }
+            updated_ = true;
+            return true;
+        }
+
+        // ||A x - b|| / ||b|| of a solve for the vector of ones
+        double ProbeResidual(const SparseMatrixType& A) const {
+            VectorType b = A * VectorType::Ones(A.cols());
+            double norm = b.norm();
+            if ( norm == 0 ) {
+                return 0;
+            }
+            VectorType x = Solve(b);
+            double residual = (A * x - b).norm() / norm;
+            return std::isfinite(residual) ? residual : NumTraits<double>::infinity();
+        }
+
+        std::unique_ptr<Base> backend_;
+        int max_rank_;
+        SparseMatrixType base_;  // A0, the matrix the backend factored
+        bool factored_ = false;
+        bool updated_ = false;
+        double base_residual_ = 0;  // probe residual of the factorization
+        std::vector<int> rows_;  // R, rows of the current update
+        SparseMatrixType update_;  // D, k x n
+        DenseMatrixType columns_;  // W, n x k
+        PartialPivLU<DenseMatrixType> capacitance_;  // S
+        std::map<int, VectorType> cached_;  // columns of W by row
+};
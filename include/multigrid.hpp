@@ -0,0 +1,335 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "Eigen/Sparse"
+
+using namespace Eigen;
+
+// connections weaker than this relative to the diagonals are ignored when aggregating
+#define AMG_STRENGTH_THRESHOLD 0.08
+// levels at or below this size are solved directly
+#define AMG_COARSEST_SIZE 200
+#define AMG_MAX_LEVELS 20
+
+
+template <typename Scalar>
+class AlgebraicMultigrid {
+
+    /*
+    Smoothed aggregation algebraic multigrid for nodal matrices
+    of resistive networks (symmetric positive definite, such as
+    the G matrix of a circuit without voltage sources).
+
+    Setup builds a hierarchy of ever smaller matrices from the
+    matrix alone. The unknowns of a level are grouped into
+    aggregates of strongly connected neighbours, each aggregate
+    becomes one unknown of the next level, and the piecewise
+    constant interpolation from aggregates is smoothed with one
+    damped Jacobi step to give the prolongation P. The coarse
+    matrix is the Galerkin product P^H A P. Coarsening stops at
+    AMG_COARSEST_SIZE unknowns, which are factored directly.
+
+    solve applies one V-cycle from a zero guess: a forward
+    Gauss-Seidel sweep, the coarse level correction of the
+    restricted residual and a backward Gauss-Seidel sweep. The
+    cycle is symmetric, so it can precondition conjugate
+    gradients, and its cost is linear in the number of nonzeros.
+    */
+
+    public:
+        typedef SparseMatrix<Scalar> MatrixType;
+        typedef SparseMatrix<Scalar, RowMajor> RowMatrixType;
+        typedef Matrix<Scalar, Dynamic, 1> VectorType;
+        typedef typename NumTraits<Scalar>::Real Real;
+
+        AlgebraicMultigrid() {}
+
+        template <typename InputType>
+        explicit AlgebraicMultigrid(const InputType& A) { compute(A); }
+
+        Index rows() const { return levels_.empty() ? 0 : levels_.front().A.rows(); }
+        Index cols() const { return rows(); }
+
+        template <typename InputType>
+        AlgebraicMultigrid& analyzePattern(const InputType&) { return *this; }
+
+        template <typename InputType>
+        AlgebraicMultigrid& factorize(const InputType& A) {
+            levels_.clear();
+            levels_.push_back(Level());
+            levels_.back().A = A;
+
+            while ( levels_.back().A.rows() > AMG_COARSEST_SIZE && int(levels_.size()) < AMG_MAX_LEVELS ) {
+                Level& fine = levels_.back();
+                SetDiagonal(fine);
+
+                std::vector<int> aggregates;
+                int count = Aggregate(fine.A, aggregates);
+                if ( count == 0 || count >= fine.A.rows() * 0.9 ) {
+                    break;  // coarsening stalled, factor this level instead
+                }
+
+                fine.P = Prolongation(fine, aggregates, count);
+                fine.R = fine.P.adjoint();
+                MatrixType A_fine = fine.A;
+                MatrixType A_coarse = fine.R * A_fine * fine.P;
+
+                levels_.push_back(Level());
+                levels_.back().A = A_coarse;
+            }
+
+            coarse_.compute(MatrixType(levels_.back().A));
+            info_ = coarse_.info();
+            return *this;
+        }
+
+        template <typename InputType>
+        AlgebraicMultigrid& compute(const InputType& A) {
+            analyzePattern(A);
+            return factorize(A);
+        }
+
+        template <typename Rhs>
+        VectorType solve(const MatrixBase<Rhs>& b) const {
+            VectorType x = VectorType::Zero(b.rows());
+            Cycle(0, b, x);
+            return x;
+        }
+
+        // one V-cycle improving x in place
+        void cycle(const VectorType& b, VectorType& x) const { Cycle(0, b, x); }
+
+        const RowMatrixType& matrix() const { return levels_.front().A; }
+
+        int levels() const { return levels_.size(); }
+
+        // total nonzeros of all levels relative to the finest
+        double operatorComplexity() const {
+            double nonzeros = 0;
+            for ( auto const& level : levels_ ) {
+                nonzeros += level.A.nonZeros();
+            }
+            return levels_.empty() ? 0 : nonzeros / levels_.front().A.nonZeros();
+        }
+
+        ComputationInfo info() const { return info_; }
+
+    private:
+        struct Level {
+            RowMatrixType A;  // row major for the smoother sweeps
+            VectorType inverse_diagonal;
+            MatrixType P;  // prolongation from the next coarser level
+            MatrixType R;  // restriction to it, P^H
+        };
+
+        static void SetDiagonal(Level& level) {
+            level.inverse_diagonal = level.A.diagonal();
+            for ( int i = 0; i < level.inverse_diagonal.rows(); i++ ) {
+                Scalar d = level.inverse_diagonal(i);
+                // rows without a diagonal (source rows) are left to the coarse correction
+                level.inverse_diagonal(i) = d != Scalar(0) ? Scalar(1) / d : Scalar(0);
+            }
+        }
+
+        static int Aggregate(const RowMatrixType& A, std::vector<int>& aggregates) {
+            /*
+            Greedy aggregation. Unknowns whose strong neighbours are
+            all free become roots of new aggregates, then the rest
+            join the aggregate of a strong neighbour, and whatever is
+            left forms aggregates with its remaining neighbours.
+            */
+            const int n = A.rows();
+            VectorType diagonal = A.diagonal();
+
+            std::vector<std::vector<int>> strong(n);
+            for ( int i = 0; i < n; i++ ) {
+                for ( typename RowMatrixType::InnerIterator it(A, i); it; ++it ) {
+                    int j = it.col();
+                    if ( j != i && std::abs(it.value()) >= AMG_STRENGTH_THRESHOLD
+                            * std::sqrt(std::abs(diagonal(i)) * std::abs(diagonal(j))) ) {
+                        strong[i].push_back(j);
+                    }
+                }
+            }
+
+            aggregates.assign(n, -1);
+            int count = 0;
+
+            for ( int i = 0; i < n; i++ ) {
+                if ( aggregates[i] != -1 ) continue;
+                bool free = true;
+                for ( int j : strong[i] ) {
+                    if ( aggregates[j] != -1 ) {
+                        free = false;
+                        break;
+                    }
+                }
+                if ( free ) {
+                    aggregates[i] = count;
+                    for ( int j : strong[i] ) {
+                        aggregates[j] = count;
+                    }
+                    count++;
+                }
+            }
+
+            std::vector<int> roots = aggregates;
+            for ( int i = 0; i < n; i++ ) {
+                if ( aggregates[i] != -1 ) continue;
+                for ( int j : strong[i] ) {
+                    if ( roots[j] != -1 ) {
+                        aggregates[i] = roots[j];
+                        break;
+                    }
+                }
+            }
+
+            for ( int i = 0; i < n; i++ ) {
+                if ( aggregates[i] != -1 ) continue;
+                aggregates[i] = count;
+                for ( int j : strong[i] ) {
+                    if ( aggregates[j] == -1 ) {
+                        aggregates[j] = count;
+                    }
+                }
+                count++;
+            }
+            return count;
+        }
+
+        static MatrixType Prolongation(const Level& level, const std::vector<int>& aggregates, int count) {
+            /*
+            P = (I - w D^-1 A) T, where T is the piecewise constant
+            interpolation from aggregates and w = 4 / (3 rho) with
+            the spectral radius rho of D^-1 A bounded by its largest
+            absolute row sum.
+            */
+            const int n = level.A.rows();
+
+            std::vector<Triplet<Scalar>> triplets;
+            triplets.reserve(n);
+            for ( int i = 0; i < n; i++ ) {
+                triplets.push_back(Triplet<Scalar>(i, aggregates[i], Scalar(1)));
+            }
+            MatrixType T(n, count);
+            T.setFromTriplets(triplets.begin(), triplets.end());
+
+            Real rho = 0;
+            for ( int i = 0; i < n; i++ ) {
+                Real sum = 0;
+                for ( typename RowMatrixType::InnerIterator it(level.A, i); it; ++it ) {
+                    sum += std::abs(it.value());
+                }
+                rho = std::max(rho, sum * std::abs(level.inverse_diagonal(i)));
+            }
+            Real omega = rho > 0 ? Real(4) / (3 * rho) : Real(0);
+
+            MatrixType DA = level.inverse_diagonal.asDiagonal() * MatrixType(level.A);
+            MatrixType P = T - Scalar(omega) * (DA * T);
+            P.makeCompressed();
+            return P;
+        }
+
+        static void Sweep(const Level& level, const VectorType& b, VectorType& x, bool forward) {
+            // Gauss-Seidel, x_i += (b_i - A_i x) / a_ii in row order
+            const int n = level.A.rows();
+            for ( int k = 0; k < n; k++ ) {
+                int i = forward ? k : n - 1 - k;
+                Scalar residual = b(i);
+                for ( typename RowMatrixType::InnerIterator it(level.A, i); it; ++it ) {
+                    residual -= it.value() * x(it.col());
+                }
+                x(i) += level.inverse_diagonal(i) * residual;
+            }
+        }
+
+        void Cycle(int index, const VectorType& b, VectorType& x) const {
+            if ( index + 1 == int(levels_.size()) ) {
+                x = coarse_.solve(b);
+                return;
+            }
+            const Level& level = levels_[index];
+
+            Sweep(level, b, x, true);
+
+            VectorType coarse_b = level.R * (b - level.A * x);
+            VectorType coarse_x = VectorType::Zero(coarse_b.rows());
+            Cycle(index + 1, coarse_b, coarse_x);
+            x += level.P * coarse_x;
+
+            Sweep(level, b, x, false);
+        }
+
+        std::vector<Level> levels_;
+        SparseLU<MatrixType, COLAMDOrdering<int>> coarse_;
+        ComputationInfo info_ = Success;
+};
+
+
+template <typename Scalar>
+class MultigridSolver {
+
+    /*
+    Stationary multigrid iteration, V-cycles repeated until the
+    relative residual is below the tolerance. Has the interface
+    of Eigen's iterative solvers so it can be used as a backend
+    the same way.
+    */
+
+    public:
+        typedef SparseMatrix<Scalar> MatrixType;
+        typedef Matrix<Scalar, Dynamic, 1> VectorType;
+
+        MultigridSolver() {}
+
+        MultigridSolver& analyzePattern(const MatrixType&) { return *this; }
+        // until the next solve, info reports the setup of the hierarchy
+        MultigridSolver& factorize(const MatrixType& A) { reset(); multigrid_.factorize(A); return *this; }
+        MultigridSolver& compute(const MatrixType& A) { reset(); multigrid_.compute(A); return *this; }
+
+        void setTolerance(double tolerance) { tolerance_ = tolerance; }
+        void setMaxIterations(int max_iterations) { max_iterations_ = max_iterations; }
+
+        template <typename Rhs>
+        VectorType solve(const MatrixBase<Rhs>& b) const {
+            return solveWithGuess(b, VectorType::Zero(b.rows()));
+        }
+
+        template <typename Rhs, typename Guess>
+        VectorType solveWithGuess(const MatrixBase<Rhs>& b, const Guess& guess) const {
+            VectorType rhs = b;
+            VectorType x = guess;
+            double scale = rhs.norm() > 0 ? rhs.norm() : 1;
+
+            iterations_ = 0;
+            error_ = (rhs - multigrid_.matrix() * x).norm() / scale;
+            while ( error_ > tolerance_ && iterations_ < max_iterations_ ) {
+                multigrid_.cycle(rhs, x);
+                error_ = (rhs - multigrid_.matrix() * x).norm() / scale;
+                iterations_++;
+            }
+            return x;
+        }
+
+        ComputationInfo info() const {
+            if ( multigrid_.info() != Success ) {
+                return multigrid_.info();
+            }
+            return error_ <= tolerance_ ? Success : NoConvergence;
+        }
+        int iterations() const { return iterations_; }
+        double error() const { return error_; }
+
+        const AlgebraicMultigrid<Scalar>& preconditioner() const { return multigrid_; }
+
+    private:
+        void reset() { iterations_ = 0; error_ = 0; }
+
+        AlgebraicMultigrid<Scalar> multigrid_;
+        double tolerance_ = 1e-6;
+        int max_iterations_ = 100;
+        mutable int iterations_ = 0;
+        mutable double error_ = 0;
+};
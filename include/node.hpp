@@ -1,8 +1,11 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <iostream>
 
+struct ChangeLog;
+
 
 // There are two types of nodes: normal and ground
 enum NodeType {
@@ -14,7 +17,7 @@ enum NodeType {
 class Node {
 
     public:
-        Node(const std::string& name, NodeType type = NORMAL);
+        Node(const std::string& name, NodeType type = NORMAL, int id = -1);
 
         const std::string& GetName() const;
 
@@ -22,9 +25,23 @@ class Node {
 
         void SetNodeType(NodeType type);
 
+        // dense id given by the circuit when the node is created
+        int GetId() const;
+
+        // row of the node voltage in the last constructed MNA system, -1 for ground
+        int GetIndex() const;
+
+        void SetIndex(int index);
+
+        // log of the circuit, grounding a node changes its topology
+        void SetChangeLog(std::shared_ptr<ChangeLog> changes);
+
     private:
         std::string name_;
         NodeType type_;
+        int id_;
+        int index_ = -1;
+        std::shared_ptr<ChangeLog> changes_;
 };
 
 std::ostream &operator<<(std::ostream& out, const Node& node);
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Eigen/Sparse"
+
+using namespace Eigen;
+
+enum OrderingType {
+    AUTO_ORDERING,  // the backend's own ordering
+    NATURAL_ORDERING,
+    AMD_ORDERING,
+    COLAMD_ORDERING,
+    RCM_ORDERING
+};
+
+const std::string OrderingName(OrderingType ordering);
+
+
+struct FillStatistics {
+
+    /*
+    Size of the factors of a matrix under an ordering, from a
+    symbolic factorization of the permuted pattern of A + A^T.
+    Pivoting can change the factors of an LU decomposition, so
+    for SparseLU the counts are an estimate.
+    */
+
+    OrderingType ordering = NATURAL_ORDERING;
+    int dimension = 0;
+    long nonzeros = 0;  // nnz(A)
+    long factor_nonzeros = 0;  // nnz(L + U), the diagonal counted once
+    double fill_ratio = 0;  // nnz(L + U) / nnz(A)
+    double flops = 0;  // multiplications and additions of the factorization
+};
+
+/*
+Fill-reducing permutation P of A, with P.indices()[i] the
+position of unknown i, so P A P^T = A.twistedBy(P) is the
+matrix factored. Orderings are computed on the pattern of
+A + A^T, AMD and COLAMD with Eigen's implementations and
+reverse Cuthill-McKee here. AUTO_ORDERING gives the identity.
+*/
+template <typename Scalar>
+PermutationMatrix<Dynamic, Dynamic, int> ComputeOrdering(const SparseMatrix<Scalar>& A, OrderingType ordering);
+
+/*
+Splits the unknowns of A into parts subdomains separated by a
+small set of separator unknowns, nested dissection style, for
+domain decomposition. Returns the part of each unknown, -1 for
+the separators. No nonzero of A + A^T connects two different
+parts.
+*/
+template <typename Scalar>
+std::vector<int> PartitionGraph(const SparseMatrix<Scalar>& A, int parts);
+
+template <typename Scalar>
+FillStatistics AnalyzeFill(const SparseMatrix<Scalar>& A, OrderingType ordering);
+
+// fill statistics of A under every ordering, one row each
+template <typename Scalar>
+void CompareOrderings(const SparseMatrix<Scalar>& A, std::ostream& out);
+
+std::ostream &operator<<(std::ostream& out, const FillStatistics& statistics);
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "circuit.hpp"
+#include "Eigen/Dense"
+
+using namespace Eigen;
+
+enum ResultType {
+    NODE_VOLTAGE,
+    VOLTAGE_SOURCE_CURRENT,
+    INDUCTOR_CURRENT
+};
+
+
+template <typename Scalar>
+class ResultStore {
+
+    /*
+    Solutions of one or more analyses of the same circuit, one
+    column per point: a steady state solve, a frequency of a
+    sweep or a time step. Row i of every column is MNA unknown
+    i, so a node voltage or branch current is found by the index
+    the circuit gave it, with no string lookups. Indexed with a
+    circuit, node voltages are also found by node id.
+
+    Every column also has a block of passive component currents,
+    entry k the current of the component object with id k. The
+    analyses fill it for resistors, capacitors and inductors, the
+    source currents are rows of the solution and stay zero there.
+
+    The values and the currents are each one contiguous array in
+    column order. A column, a row across every point, or the
+    whole table are Eigen maps into them, so millions of values
+    are read without copying them. Names are resolved once
+    through a hash table to an index, which is then used
+    directly.
+
+    Scalar is complex for steady state and AC results and real
+    for transient ones, which then take half the memory.
+
+    Rows that are both a node and a component name resolve to
+    the node.
+    */
+
+    public:
+        typedef Matrix<Scalar, Dynamic, 1> VectorType;
+        typedef Matrix<Scalar, Dynamic, Dynamic> MatrixType;
+        typedef Map<const VectorType, 0, InnerStride<>> Trace;
+
+        ResultStore() {}
+
+        // names of the rows, drops the stored columns
+        void SetIndexes(
+            const std::map<std::string, int>& node_indexes,
+            const std::map<std::string, int>& voltage_source_indexes,
+            const std::map<std::string, int>& inductor_indexes,
+            int rows
+        );
+        // names, node ids and component ids of a constructed circuit
+        void SetIndexes(const Circuit& circuit);
+        // size of the current block, zeroes the stored currents
+        void SetComponentCount(int count);
+        // keeps the names
+        void Clear();
+        void Reserve(int columns);
+        // columns can then be written in any order, from several threads
+        void Resize(const std::vector<float>& points);
+        // false if x does not have a value for every row, the currents of the column are zero
+        bool AddColumn(float point, const VectorType& x);
+
+        int GetRows() const { return rows_; };
+        int GetColumns() const { return points_.size(); };
+        int GetComponentCount() const { return components_; };
+        // time or angular frequency of each column
+        const std::vector<float>& GetPoints() const { return points_; };
+        void SetPoint(int column, float point) { points_[column] = point; };
+
+        // index of a node or of a voltage source or inductor current, -1 if unknown
+        int GetIndex(const std::string& name) const;
+        ResultType GetType(int index) const { return types_[index]; };
+        const std::string& GetName(int index) const { return names_[index]; };
+        // row of a node id, -1 for ground and unknown nodes
+        int GetNodeIndex(int node_id) const;
+        const std::vector<int>& GetNodeRows() const { return node_rows_; };
+        // id of a component object, -1 if unknown
+        int GetComponentId(const std::string& name) const;
+
+        Scalar Get(int index, int column) const { return values_[size_t(column) * rows_ + index]; };
+        // voltage of a node id, zero at ground
+        Scalar GetVoltage(int node_id, int column) const;
+        Scalar GetCurrent(int component_id, int column) const { return currents_[size_t(column) * components_ + component_id]; };
+
+        Map<VectorType> Column(int column) { return Map<VectorType>(values_.data() + size_t(column) * rows_, rows_); };
+        Map<const VectorType> GetColumn(int column) const { return Map<const VectorType>(values_.data() + size_t(column) * rows_, rows_); };
+        Map<VectorType> Currents(int column) { return Map<VectorType>(currents_.data() + size_t(column) * components_, components_); };
+        Map<const VectorType> GetCurrents(int column) const { return Map<const VectorType>(currents_.data() + size_t(column) * components_, components_); };
+        // one row or component current over every column
+        Trace GetTrace(int index) const { return Trace(values_.data() + index, GetColumns(), InnerStride<>(rows_)); };
+        Trace GetCurrentTrace(int component_id) const { return Trace(currents_.data() + component_id, GetColumns(), InnerStride<>(components_)); };
+        Map<const MatrixType> GetValues() const { return Map<const MatrixType>(values_.data(), rows_, GetColumns()); };
+
+        std::ostream& resultListed(std::ostream &out) const;
+
+    private:
+        int rows_ = 0;
+        int components_ = 0;
+        std::vector<Scalar> values_;
+        std::vector<Scalar> currents_;  // components_ per column
+        std::vector<float> points_;
+        std::vector<std::string> names_;  // by row, empty for rows without a name
+        std::vector<ResultType> types_;
+        std::unordered_map<std::string, int> indexes_;
+        std::vector<int> node_rows_;  // by node id
+        std::unordered_map<std::string, int> component_ids_;
+};
+
+// steady state and AC results
+typedef ResultStore<cd> SimulationResults;
+typedef ResultStore<float> TransientResults;
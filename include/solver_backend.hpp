@@ -0,0 +1,290 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "Eigen/Dense"
+#include "Eigen/Sparse"
+#include "ordering.hpp"
+
+using namespace Eigen;
+
+typedef std::complex<float> cd;
+
+// above this fill ratio a sparse matrix is factored with a dense backend
+#define DENSE_BACKEND_DENSITY 0.25
+
+// default relative residual and iteration cap of the Krylov backends
+#define ITERATIVE_TOLERANCE 1e-6
+#define ITERATIVE_MAX_ITERATIONS 1000
+
+// relative residual and step limit of iterative refinement
+#define REFINEMENT_TOLERANCE 1e-10
+#define MAX_REFINEMENT_STEPS 10
+
+enum SolverBackendType {
+    AUTO_BACKEND,
+    PARTIAL_PIV_LU,
+    FULL_PIV_LU,
+    DENSE_LDLT,
+    SPARSE_LU,
+    SPARSE_LDLT,
+    CONJUGATE_GRADIENT,
+    BICGSTAB_ILU0,
+    BICGSTAB_ILUT,
+    GMRES_ILU0,
+    GMRES_ILUT,
+    MULTIGRID,
+    CONJUGATE_GRADIENT_AMG,
+    SCHUR_COMPLEMENT  // experimental, only used when asked for
+};
+
+
+struct MatrixProperties {
+
+    /*
+    Structural and numerical properties of an MNA matrix
+    used to pick a decomposition for it.
+    */
+
+    int dimension = 0;
+    int nonzeros = 0;
+    float density = 0;  // nonzeros / dimension^2
+    bool symmetric = false;  // A == A^T
+    bool hermitian = false;  // A == A^H
+    bool definite = false;  // hermitian with positive diagonal, no source or inductor rows
+    std::uint64_t fingerprint = 0;  // hash of the sparsity pattern
+};
+
+template <typename Scalar>
+MatrixProperties AnalyzeMatrix(const SparseMatrix<Scalar>& A);
+
+template <typename Scalar>
+std::uint64_t PatternFingerprint(const SparseMatrix<Scalar>& A);
+
+SolverBackendType SelectBackend(const MatrixProperties& properties);
+
+const std::string BackendName(SolverBackendType type);
+
+// ordering a backend uses on its own, NATURAL_ORDERING if it has none
+OrderingType DefaultOrdering(SolverBackendType type);
+
+
+template <typename Scalar>
+class SolverBackend {
+
+    /*
+    Base class for the decompositions MNAsolver can use.
+
+    A backend factors the MNA matrix once in Compute and
+    then solves for any number of right hand sides. Dense
+    backends accept sparse matrices and vice versa, the
+    matrix is converted to the storage the backend needs.
+
+    Sparse backends split Compute into a symbolic Analyze,
+    which only depends on the sparsity pattern, and a numeric
+    Factorize that can be repeated for new values.
+
+    A sparse direct backend can be given an explicit fill-reducing
+    ordering, which replaces its own, see ReorderedBackend.
+
+    Iterative backends only build a preconditioner in Compute
+    and solve to a tolerance, starting from a guess if given.
+
+    Backends are templated on the scalar type so that DC
+    analysis can factor real matrices and AC complex ones.
+    */
+
+    public:
+        typedef Matrix<Scalar, Dynamic, Dynamic> DenseMatrixType;
+        typedef SparseMatrix<Scalar> SparseMatrixType;
+        typedef Matrix<Scalar, Dynamic, 1> VectorType;
+
+        virtual ~SolverBackend() {}
+
+        virtual bool Compute(const DenseMatrixType& A) = 0;
+
+        virtual bool Compute(const SparseMatrixType& A) = 0;
+
+        virtual bool Analyze(const SparseMatrixType&) { return true; }
+
+        virtual bool Factorize(const SparseMatrixType& A) { return Compute(A); }
+
+        virtual VectorType Solve(const VectorType& z) const = 0;
+
+        virtual SolverBackendType GetType() const = 0;
+
+        // AUTO_ORDERING unless the backend was created with an explicit ordering
+        virtual OrderingType GetOrdering() const { return AUTO_ORDERING; }
+
+        // direct backends are exact and ignore these
+        virtual bool IsIterative() const { return false; }
+        virtual void SetTolerance( double, int ) {}
+        virtual VectorType SolveWithGuess(const VectorType& z, const VectorType&) const { return Solve(z); }
+        virtual bool Converged() const { return true; }
+        virtual int GetIterations() const { return 0; }
+        virtual double GetError() const { return 0; }
+
+        const std::string GetName() const { return BackendName(GetType()); };
+};
+
+
+template <typename Decomposition, SolverBackendType Type>
+class DenseBackend : public SolverBackend<typename Decomposition::Scalar> {
+    public:
+        typedef SolverBackend<typename Decomposition::Scalar> Base;
+
+        bool Compute(const typename Base::DenseMatrixType& A) {
+            decomposition_.compute(A);
+            return true;
+        }
+
+        bool Compute(const typename Base::SparseMatrixType& A) {
+            return Compute(typename Base::DenseMatrixType(A));
+        }
+
+        typename Base::VectorType Solve(const typename Base::VectorType& z) const {
+            return decomposition_.solve(z);
+        }
+
+        SolverBackendType GetType() const { return Type; }
+
+    private:
+        Decomposition decomposition_;
+};
+
+
+template <typename Decomposition, SolverBackendType Type>
+class SparseBackend : public SolverBackend<typename Decomposition::Scalar> {
+    public:
+        typedef SolverBackend<typename Decomposition::Scalar> Base;
+
+        bool Compute(const typename Base::DenseMatrixType& A) {
+            return Compute(typename Base::SparseMatrixType(A.sparseView()));
+        }
+
+        bool Compute(const typename Base::SparseMatrixType& A) {
+            decomposition_.compute(A);
+            return decomposition_.info() == Success;
+        }
+
+        bool Analyze(const typename Base::SparseMatrixType& A) {
+            decomposition_.analyzePattern(A);
+            return true;
+        }
+
+        bool Factorize(const typename Base::SparseMatrixType& A) {
+            decomposition_.factorize(A);
+            return decomposition_.info() == Success;
+        }
+
+        typename Base::VectorType Solve(const typename Base::VectorType& z) const {
+            return decomposition_.solve(z);
+        }
+
+        SolverBackendType GetType() const { return Type; }
+
+    private:
+        Decomposition decomposition_;
+};
+
+
+template <typename Scalar>
+class ReorderedBackend : public SolverBackend<Scalar> {
+
+    /*
+    Applies a fill-reducing ordering before factorization. The
+    wrapped backend factors B = P A P^T in the order given, so it
+    must not reorder itself (NaturalOrdering), and x = P^T B \ P z.
+    The permutation is computed in Analyze, from the pattern only.
+    */
+
+    public:
+        typedef SolverBackend<Scalar> Base;
+
+        ReorderedBackend(std::unique_ptr<Base> backend, OrderingType ordering)
+            : backend_(std::move(backend)), ordering_(ordering) { }
+
+        bool Compute(const typename Base::DenseMatrixType& A) {
+            return Compute(typename Base::SparseMatrixType(A.sparseView()));
+        }
+
+        bool Compute(const typename Base::SparseMatrixType& A) {
+            Analyze(A);
+            return Factorize(A);
+        }
+
+        bool Analyze(const typename Base::SparseMatrixType& A) {
+            permutation_ = ComputeOrdering(A, ordering_);
+            return backend_->Analyze(Permute(A));
+        }
+
+        bool Factorize(const typename Base::SparseMatrixType& A) {
+            if ( permutation_.size() != A.rows() ) {
+                permutation_ = ComputeOrdering(A, ordering_);
+            }
+            return backend_->Factorize(Permute(A));
+        }
+
+        typename Base::VectorType Solve(const typename Base::VectorType& z) const {
+            typename Base::VectorType y = backend_->Solve(permutation_ * z);
+            return permutation_.transpose() * y;
+        }
+
+        SolverBackendType GetType() const { return backend_->GetType(); }
+
+        OrderingType GetOrdering() const { return ordering_; }
+
+    private:
+        typename Base::SparseMatrixType Permute(const typename Base::SparseMatrixType& A) const {
+            return permutation_ * A * permutation_.transpose();
+        }
+
+        std::unique_ptr<Base> backend_;
+        OrderingType ordering_;
+        PermutationMatrix<Dynamic, Dynamic, int> permutation_;
+};
+
+
+template <typename Scalar>
+using PartialPivLUBackend = DenseBackend<PartialPivLU<Matrix<Scalar, Dynamic, Dynamic>>, PARTIAL_PIV_LU>;
+template <typename Scalar>
+using FullPivLUBackend = DenseBackend<FullPivLU<Matrix<Scalar, Dynamic, Dynamic>>, FULL_PIV_LU>;
+template <typename Scalar>
+using DenseLDLTBackend = DenseBackend<LDLT<Matrix<Scalar, Dynamic, Dynamic>>, DENSE_LDLT>;
+template <typename Scalar>
+using SparseLUBackend = SparseBackend<SparseLU<SparseMatrix<Scalar>, COLAMDOrdering<int>>, SPARSE_LU>;
+template <typename Scalar>
+using SparseLDLTBackend = SparseBackend<SimplicialLDLT<SparseMatrix<Scalar>>, SPARSE_LDLT>;
+
+// the ordering only applies to SPARSE_LU and SPARSE_LDLT, AUTO_ORDERING keeps their own
+template <typename Scalar>
+std::unique_ptr<SolverBackend<Scalar>> CreateBackend(SolverBackendType type, OrderingType ordering = AUTO_ORDERING);
+
+
+// single precision counterpart of a scalar type
+template <typename Scalar>
+struct SinglePrecision { typedef Scalar type; };
+template <>
+struct SinglePrecision<double> { typedef float type; };
+template <>
+struct SinglePrecision<std::complex<double>> { typedef std::complex<float> type; };
+
+
+struct RefinementResult {
+    int steps = 0;  // corrections after the first solve
+    double residual = 0;  // ||b - A x|| / ||b|| of the returned x
+    bool converged = false;  // residual is below the tolerance
+};
+
+template <typename Scalar>
+RefinementResult SolveRefined(
+    const SolverBackend<typename SinglePrecision<Scalar>::type>& backend,
+    const SparseMatrix<Scalar>& A,
+    const Matrix<Scalar, Dynamic, 1>& b,
+    Matrix<Scalar, Dynamic, 1>& x,
+    double tolerance = REFINEMENT_TOLERANCE,
+    int max_steps = MAX_REFINEMENT_STEPS
+);
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "component.hpp"
+#include "component_store.hpp"
+#include "Eigen/Dense"
+#include "Eigen/Sparse"
+
+using namespace Eigen;
+
+struct SourceStamp {
+    std::shared_ptr<Component> source;
+    int row;
+    float sign;
+};
+
+
+struct StampContext {
+
+    /*
+    Triplet lists and source vector that the stamp kernels add
+    to. Every entry goes to G, C and Gamma alike (zero where it
+    does not belong) so the three share one sparsity pattern.
+    Index -1 is the ground node, entries on it are dropped.
+
+    source is the component being stamped, if it is an object,
+    so that transient analysis can reevaluate its waveform.
+
+    With offsets set the context scatters instead: the k-th entry
+    is added to the value arrays at offsets[k], the position the
+    assembly plan found for it in the compressed matrices. The
+    stamps of a topology always come in the same order, so
+    restamping new values is a scatter-add without searching or
+    allocating. cursor counts the entries, a count that differs
+    from the plan means the topology changed. scale multiplies
+    every value, -1 removes a previous stamp, and touched and
+    touched_rows collect the positions and source rows written.
+    */
+
+    std::vector<Triplet<double>> g;
+    std::vector<Triplet<double>> c;
+    std::vector<Triplet<double>> gamma;
+    VectorXd* s = nullptr;
+    std::vector<SourceStamp>* source_stamps = nullptr;
+    std::shared_ptr<Component> source;
+    bool dc = true;  // DC indexing, every inductor has a branch row
+
+    const std::vector<int>* offsets = nullptr;
+    size_t cursor = 0;
+    double* g_values = nullptr;
+    double* c_values = nullptr;
+    double* gamma_values = nullptr;
+    double scale = 1;
+    std::vector<int>* touched = nullptr;
+    std::vector<int>* touched_rows = nullptr;
+
+    // index of the next entry, in the triplet lists or the plan
+    size_t Position() const { return offsets ? cursor : g.size(); }
+
+    void Reserve(size_t count) {
+        g.reserve(count);
+        c.reserve(count);
+        gamma.reserve(count);
+    }
+
+    void Add(int row, int col, double g_value, double c_value, double gamma_value) {
+        if ( row < 0 || col < 0 ) return;
+        if ( offsets ) {
+            if ( cursor < offsets->size() ) {
+                int position = (*offsets)[cursor];
+                g_values[position] += scale * g_value;
+                c_values[position] += scale * c_value;
+                gamma_values[position] += scale * gamma_value;
+                if ( touched ) touched->push_back(position);
+            }
+            cursor++;
+        } else {
+            g.push_back(Triplet<double>(row, col, scale * g_value));
+            c.push_back(Triplet<double>(row, col, scale * c_value));
+            gamma.push_back(Triplet<double>(row, col, scale * gamma_value));
+        }
+    }
+
+    // admittance between two nodes, or between a node and ground
+    void Admittance(int out, int in, double y_g, double y_c, double y_gamma) {
+        Add(out, in, -y_g, -y_c, -y_gamma);
+        Add(in, out, -y_g, -y_c, -y_gamma);
+        Add(out, out, y_g, y_c, y_gamma);
+        Add(in, in, y_g, y_c, y_gamma);
+    }
+
+    void Source(int row, float sign, double value) {
+        if ( row < 0 ) return;
+        (*s)(row) += scale * sign * value;
+        if ( touched_rows ) touched_rows->push_back(row);
+        if ( source && source_stamps ) {
+            source_stamps->push_back({ source, row, sign });
+        }
+    }
+};
+
+
+/*
+Stamp of one component type, specialized per ComponentType.
+Apply adds a component with terminals at rows out and in, its
+branch row (voltage sources and DC inductors, -1 otherwise) and
+value to the context. The assembly loops are instantiated per
+type, so the kernel is inlined and nothing is dispatched per
+component. A new element type needs a ComponentType, a
+specialization here and a case in StampComponent.
+*/
+template <ComponentType Type>
+struct StampKernel;
+
+template <>
+struct StampKernel<RESISTOR> {
+    static void Apply(StampContext& context, int out, int in, int, double value) {
+        context.Admittance(out, in, value > 0.0 ? 1 / value : 0, 0, 0);  // Y = 1 / R
+    }
+};
+
+template <>
+struct StampKernel<CAPACITOR> {
+    static void Apply(StampContext& context, int out, int in, int, double value) {
+        context.Admittance(out, in, 0, value > 0.0 ? value : 0, 0);  // Y = jw * C
+    }
+};
+
+template <>
+struct StampKernel<INDUCTOR> {
+    static void Apply(StampContext& context, int out, int in, int branch, double value) {
+        if ( !context.dc ) {
+            context.Admittance(out, in, 0, 0, value > 0.0 ? 1 / value : 0);  // Y = 1 / (jw * L)
+            return;
+        }
+        // branch row V_in - V_out - L di/dt = 0, the L term only matters for transient analysis
+        context.Admittance(out, in, 0, 0, 0);
+        context.Add(out, branch, -1, 0, 0);
+        context.Add(branch, out, -1, 0, 0);
+        context.Add(in, branch, 1, 0, 0);
+        context.Add(branch, in, 1, 0, 0);
+        context.Add(branch, branch, 0, value > 0.0 ? -value : 0, 0);
+    }
+};
+
+template <>
+struct StampKernel<VOLTAGE_SOURCE> {
+    static void Apply(StampContext& context, int out, int in, int branch, double value) {
+        context.Add(branch, out, 1, 0, 0);  // B submatrix
+        context.Add(out, branch, 1, 0, 0);  // C submatrix
+        context.Add(branch, in, -1, 0, 0);
+        context.Add(in, branch, -1, 0, 0);
+        context.Source(branch, 1, value);
+    }
+};
+
+template <>
+struct StampKernel<CURRENT_SOURCE> {
+    static void Apply(StampContext& context, int out, int in, int, double value) {
+        context.Source(out, 1, value);
+        context.Source(in, -1, value);
+    }
+};
+
+
+/*
+Stamps a component object with the kernel of its type. Its type,
+terminals and value still come from the virtual getters of the
+object, so objects cost a few virtual calls and a switch each,
+the element store none.
+*/
+inline void StampComponent(StampContext& context, ComponentType type, int out, int in, int branch, double value) {
+    switch ( type ) {
+        case RESISTOR:
+            StampKernel<RESISTOR>::Apply(context, out, in, branch, value);
+            break;
+        case CAPACITOR:
+            StampKernel<CAPACITOR>::Apply(context, out, in, branch, value);
+            break;
+        case INDUCTOR:
+            StampKernel<INDUCTOR>::Apply(context, out, in, branch, value);
+            break;
+        case VOLTAGE_SOURCE:
+            StampKernel<VOLTAGE_SOURCE>::Apply(context, out, in, branch, value);
+            break;
+        case CURRENT_SOURCE:
+            StampKernel<CURRENT_SOURCE>::Apply(context, out, in, branch, value);
+            break;
+        default:
+            break;
+    }
+}
+
+// stamps every connected entry of the arrays of one type
+template <ComponentType Type>
+void StampArrays(
+        StampContext& context,
+        const ComponentStore::Arrays& arrays,
+        const std::vector<int>& branches,  // branch rows, empty for types without one
+        const std::vector<int>& node_rows
+    ) {
+    const size_t size = arrays.values.size();
+    for ( size_t k = 0; k < size; k++ ) {
+        int out = arrays.outputs[k];
+        int in = arrays.inputs[k];
+        if ( out < 0 || in < 0 ) continue;  // not connected
+        int branch = branches.empty() ? -1 : branches[k];
+        StampKernel<Type>::Apply(context, node_rows[out], node_rows[in], branch, arrays.values[k]);
+    }
+}
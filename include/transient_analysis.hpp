@@ -0,0 +1,126 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "circuit.hpp"
+#include "simulation_results.hpp"
+#include "Eigen/Dense"
+#include "Eigen/Sparse"
+
+using namespace Eigen;
+
+enum IntegrationMethod {
+    BACKWARD_EULER,
+    TRAPEZOIDAL
+};
+
+
+class TransientAnalysis {
+
+    /*
+    Time domain analysis of the circuit equation
+
+        G x + C dx/dt = s(t)
+
+    where G, C and s are the stamp matrices of the circuit
+    constructed for DC (every inductor has a current row) and
+    s(t) evaluates the source waveforms.
+
+    Capacitors and inductors are replaced by their companion
+    models, a conductance k*C/h in parallel with a history
+    source (k = 1 for backward Euler, 2 for trapezoidal). In
+    matrix form every step solves
+
+        (G + k*C/h) x_n+1 = s(t_n+1) + k*C/h x_n + (k - 1) y_n
+
+    where y_n = C dx/dt is the current of the reactive elements
+    at the previous step. The matrix only depends on h, so it
+    is factored once per step size and every step is a single
+    forward and back substitution. The first trapezoidal step
+    after t = 0 or a breakpoint is split into two backward Euler
+    half steps, which have the same matrix, to damp ringing
+    from the discontinuity.
+
+    With adaptive stepping the step is chosen from an estimate
+    of the local truncation error (the difference between the
+    solution and a polynomial predictor through the previous
+    points), and the analysis steps exactly onto the breakpoints
+    of the source waveforms. Step sizes are restricted to
+    step / ratio^k, where ratio is the refactor threshold, and
+    the factorization of every size is kept, so the matrix is
+    only refactored when the step changes by at least that
+    ratio, or when a step is cut short to land on a breakpoint.
+
+    The solution of each step is handed to an output callback
+    instead of being stored, so memory use does not grow with
+    the number of steps. The analysis starts from a zero state
+    (uncharged capacitors, no inductor currents) unless the DC
+    operating point is requested.
+    */
+
+    public:
+        typedef std::function<void(float time, const VectorXf& x)> Output;
+
+        // with adaptive stepping step is the largest step allowed
+        TransientAnalysis(float step, float stop, IntegrationMethod method = TRAPEZOIDAL);
+
+        void SetUseOperatingPoint( bool use ) { use_operating_point_ = use; };
+        void SetAdaptive( bool adaptive ) { adaptive_ = adaptive; };
+        void SetTolerances( float reltol, float abstol ) { reltol_ = reltol; abstol_ = abstol; };
+        void SetRefactorThreshold( float ratio ) { ratio_ = ratio > 1 ? ratio : 2; };
+
+        bool Run(Circuit& circuit, Output output);
+
+        // streams a table of node voltages and branch currents per step
+        bool Run(Circuit& circuit, std::ostream& out);
+
+        /*
+        Keeps the solution of every step as a column of results,
+        at its time, with the currents of the resistors, capacitors
+        and inductors in the current block of the column.
+        */
+        bool Run(Circuit& circuit, TransientResults& results);
+
+        const int GetStepCount() const { return steps_; };
+        const int GetSolveCount() const { return solves_; };
+        const int GetRejectedStepCount() const { return rejected_; };
+        const int GetFactorizationCount() const { return factorizations_; };
+        const std::map<std::string, int>& GetNodeIndexes() const { return node_indexes_; };
+        const std::map<std::string, int>& GetVoltageSourceIndexes() const { return voltage_source_indexes_; };
+        const std::map<std::string, int>& GetInductorIndexes() const { return inductor_indexes_; };
+
+    private:
+        struct Branch {
+            int id;  // of the component object
+            ComponentType type;
+            int out;  // rows of the terminals, -1 at ground
+            int in;
+            int row;  // current row of an inductor
+            float value;
+        };
+
+        // currents of the passive components at solution x, by component id
+        void PassiveCurrents(const VectorXf& x, Ref<VectorXf> currents) const;
+
+        float step_;
+        float stop_;
+        IntegrationMethod method_;
+        bool use_operating_point_ = false;
+        bool adaptive_ = false;
+        float reltol_ = 1e-3;
+        float abstol_ = 1e-6;
+        float ratio_ = 2;
+
+        int steps_ = 0;
+        int solves_ = 0;
+        int rejected_ = 0;
+        int factorizations_ = 0;
+        std::map<std::string, int> node_indexes_;
+        std::map<std::string, int> voltage_source_indexes_;
+        std::map<std::string, int> inductor_indexes_;
+        std::vector<Branch> branches_;  // passive component objects of the last run
+        VectorXf capacitor_currents_;  // by branch, of the last accepted point
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+
+class Waveform {
+
+    /*
+    Base class for time varying source values.
+
+    A waveform gives the value of a source at any time and
+    the breakpoints where its derivative is discontinuous,
+    which transient analysis must step onto exactly.
+    */
+
+    public:
+        virtual ~Waveform() {}
+
+        virtual float GetValue(float time) const = 0;
+
+        // breakpoints in (0, stop], sorted
+        virtual std::vector<float> GetBreakpoints(float stop) const = 0;
+};
+
+
+class PulseWaveform : public Waveform {
+
+    /*
+    SPICE PULSE(v1 v2 delay rise fall width period). A period
+    of zero makes a single pulse.
+    */
+
+    public:
+        PulseWaveform(float v1, float v2, float delay, float rise, float fall, float width, float period = 0);
+
+        float GetValue(float time) const;
+
+        std::vector<float> GetBreakpoints(float stop) const;
+
+    private:
+        float v1_;
+        float v2_;
+        float delay_;
+        float rise_;
+        float fall_;
+        float width_;
+        float period_;
+};
+
+
+class SineWaveform : public Waveform {
+
+    /*
+    SPICE SIN(offset amplitude frequency delay damping),
+    frequency in hertz. The source stays at offset until delay.
+    */
+
+    public:
+        SineWaveform(float offset, float amplitude, float frequency, float delay = 0, float damping = 0);
+
+        float GetValue(float time) const;
+
+        std::vector<float> GetBreakpoints(float stop) const;
+
+    private:
+        float offset_;
+        float amplitude_;
+        float frequency_;
+        float delay_;
+        float damping_;
+};
+
+
+class PWLWaveform : public Waveform {
+
+    /*
+    SPICE PWL, a piecewise linear waveform through (time, value)
+    points sorted by time. The value is held constant before the
+    first and after the last point.
+    */
+
+    public:
+        PWLWaveform(const std::vector<std::pair<float, float>>& points);
+
+        float GetValue(float time) const;
+
+        std::vector<float> GetBreakpoints(float stop) const;
+
+    private:
+        std::vector<std::pair<float, float>> points_;
+};
@@ -1,32 +1,504 @@
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+
 #include "MNAsolver.hpp"
 
 MNAsolver::MNAsolver(){}
 
+template <>
+MNAsolver::BackendCache<float>& MNAsolver::cache<float>() { return float_cache_; }
+template <>
+MNAsolver::BackendCache<double>& MNAsolver::cache<double>() { return double_cache_; }
+template <>
+MNAsolver::BackendCache<cd>& MNAsolver::cache<cd>() { return complex_cache_; }
+template <>
+MNAsolver::BackendCache<std::complex<double>>& MNAsolver::cache<std::complex<double>>() { return complex_double_cache_; }
+
+template <typename Scalar>
+void MNAsolver::solveSystem(
+        const Matrix<Scalar, Dynamic, Dynamic>& A,
+        const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z
+    ) {
+    /*
+    Solves Ax = z by factoring A with the selected backend,
+    the inverse of A is never formed.
+    */
+    auto start = std::chrono::steady_clock::now();
+    island_count_ = 1;
+    if ( mixed_precision_ && !std::is_same<Scalar, typename SinglePrecision<Scalar>::type>::value ) {
+        solveMixed(SparseMatrix<Scalar>(A.sparseView()), z);
+    } else {
+        BackendCache<Scalar>& backend = cache<Scalar>();
+        setSolution(factorize(backend, A), backend, z);
+    }
+    solve_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Scalar>
+void MNAsolver::solveSystem(
+        const SparseMatrix<Scalar>& A,
+        const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z
+    ) {
+    auto start = std::chrono::steady_clock::now();
+    island_count_ = 1;
+    if ( mixed_precision_ && !std::is_same<Scalar, typename SinglePrecision<Scalar>::type>::value ) {
+        solveMixed(A, z);
+    } else {
+        BackendCache<Scalar>& backend = cache<Scalar>();
+        setSolution(factorize(backend, A), backend, z);
+    }
+    solve_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Scalar>
+void MNAsolver::solveSteady(
+        const Matrix<Scalar, Dynamic, Dynamic>& A, 
+        const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z,
+        float omega, 
+        const std::map<std::string, int>& node_indexes, 
+        const std::map<std::string, int>& voltage_source_indexes, 
+        const std::map<std::string, int>& inductor_indexes 
+    ) {
+    solveSystem(A, z);
+    setResults(omega, node_indexes, voltage_source_indexes, inductor_indexes);
+}
+
+template <typename Scalar>
+void MNAsolver::solveSteady(
+        const SparseMatrix<Scalar>& A, 
+        const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z,
+        float omega, 
+        const std::map<std::string, int>& node_indexes, 
+        const std::map<std::string, int>& voltage_source_indexes, 
+        const std::map<std::string, int>& inductor_indexes 
+    ) {
+    solveSystem(A, z);
+    setResults(omega, node_indexes, voltage_source_indexes, inductor_indexes);
+}
+
 void MNAsolver::solveSteady(
         const MatrixXcf& A, 
-        const VectorXcf& z,
+        const VectorXf& z,
         float omega, 
-        std::map<std::string, int> node_indexes, 
-        std::map<std::string, int> voltage_source_indexes, 
-        std::map<std::string, int> inductor_indexes 
+        const std::map<std::string, int>& node_indexes, 
+        const std::map<std::string, int>& voltage_source_indexes, 
+        const std::map<std::string, int>& inductor_indexes 
+    ) {
+    solveSteady<cd>(A, z, omega, node_indexes, voltage_source_indexes, inductor_indexes);
+}
+
+void MNAsolver::solveSteady(const Circuit& circuit) {
+    /*
+    Picks the storage the circuit was assembled in: real
+    matrices at DC, complex ones at AC, sparse or dense by the
+    circuit's assembly mode. Sparse circuits with several
+    islands are solved island by island. The solution of a
+    reduced circuit is expanded to every unknown before the
+    results are set.
+    */
+    const bool reduced = circuit.IsReduced();
+    SetMatrixProperties(reduced ? circuit.GetReducedMatrixProperties() : circuit.GetMatrixProperties());
+    const SparseMatrix<float>& A_real = reduced ? circuit.GetReducedAMatrix() : circuit.GetRealSparseAMatrix();
+    const VectorXf& z = reduced ? circuit.GetReducedZMatrix() : circuit.GetZMatrix();
+    bool split = false;
+    if ( island_solving_ && circuit.GetIslandCount() > 1 && circuit.IsSparse() && !mixed_precision_ ) {
+        auto start = std::chrono::steady_clock::now();
+        split = circuit.IsReal()
+            ? solveIslands<float>(A_real, z, circuit.GetIslands(), circuit.GetIslandCount())
+            : solveIslands<cd>(circuit.GetComplexSparseAMatrix(), z, circuit.GetIslands(), circuit.GetIslandCount());
+        if ( split ) {
+            solve_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    if ( !split ) {
+        if ( reduced ) {
+            // the reduced system is only kept sparse
+            if ( circuit.IsSparse() ) {
+                solveSystem<float>(A_real, z);
+            } else {
+                solveSystem<float>(MatrixXf(A_real), z);
+            }
+        } else if ( circuit.IsReal() ) {
+            if ( circuit.IsSparse() ) {
+                solveSystem<float>(circuit.GetRealSparseAMatrix(), circuit.GetZMatrix());
+            } else {
+                solveSystem<float>(circuit.GetRealAMatrix(), circuit.GetZMatrix());
+            }
+        } else if ( circuit.IsSparse() ) {
+            solveSystem<cd>(circuit.GetComplexSparseAMatrix(), circuit.GetZMatrix());
+        } else {
+            solveSystem<cd>(circuit.GetComplexAMatrix(), circuit.GetZMatrix());
+        }
+    }
+    if ( reduced ) {
+        VectorXd x;
+        circuit.ExpandSolution(x_.real(), x);
+        x_ = x.cast<std::complex<double>>();
+    }
+    setResults(circuit.GetOmega(), circuit.GetNodeIndexes(), circuit.GetVoltageSourceIndexes(), circuit.GetInductorIndexes(), &circuit);
+}
+
+template <typename Scalar>
+void MNAsolver::solveMixed(
+        const SparseMatrix<Scalar>& A, 
+        const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z
     ) {
+    /*
+    Factors a single precision copy of A, with the analysis
+    cache of the single precision type, and refines the
+    solution against A itself.
+    */
+    typedef typename SinglePrecision<Scalar>::type Single;
+
+    BackendCache<Single>& backend = cache<Single>();
+    real_ = !NumTraits<Scalar>::IsComplex;
+    refined_ = true;
+    refinement_ = RefinementResult();
+    iterative_ = false;
+    iterations_ = 0;
+    iterative_error_ = 0;
+
+    if ( !factorize(backend, SparseMatrix<Single>(A.template cast<Single>())) ) {
+        x_ = VectorXcd::Zero(z.rows());
+        solved_ = false;
+        return;
+    }
+
+    Matrix<Scalar, Dynamic, 1> x;
+    refinement_ = SolveRefined(*backend.backend, A, Matrix<Scalar, Dynamic, 1>(z.template cast<Scalar>()),
+        x, refinement_tolerance_, max_refinement_steps_);
+    x_ = x.template cast<std::complex<double>>();
+    solved_ = x_.allFinite();
+}
+
+template <typename Scalar>
+void MNAsolver::setSolution(
+        bool factored,
+        BackendCache<Scalar>& cache,
+        const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z
+    ) {
+    /*
+    The right-hand side and the solution live in the cache and
+    x_ keeps its storage, a solve of the same size writes into
+    the vectors of the previous one.
+    */
+    real_ = !NumTraits<Scalar>::IsComplex;
+    refined_ = false;
+    refinement_ = RefinementResult();
+    iterative_ = false;
+    iterations_ = 0;
+    iterative_error_ = 0;
+    if ( factored ) {
+        const SolverBackend<Scalar>& backend = *cache.backend;
+        cache.rhs = z.template cast<Scalar>();
+        cache.solution = backend.IsIterative() ? backend.SolveWithGuess(cache.rhs, cache.guess) : backend.Solve(cache.rhs);
+        if ( backend.IsIterative() ) {
+            cache.guess = cache.solution;
+        }
+        iterative_ = backend.IsIterative();
+        iterations_ = backend.GetIterations();
+        iterative_error_ = backend.GetError();
+        x_ = cache.solution.template cast<std::complex<double>>();
+        solved_ = x_.allFinite() && backend.Converged();
+    } else {
+        x_.setZero(z.rows());
+        solved_ = false;
+    }
+}
+
+template <typename Scalar>
+bool MNAsolver::factorize(BackendCache<Scalar>& cache, const Matrix<Scalar, Dynamic, Dynamic>& A) {
+    SolverBackendType type = backend_type_;
+    if ( type == AUTO_BACKEND ) {
+        SparseMatrix<Scalar> sparse = A.sparseView();
+        type = resolveBackend(sparse, PatternFingerprint(sparse));
+    }
+    cache.backend = CreateBackend<Scalar>(type, ordering_);
+    cache.backend->SetTolerance(iterative_tolerance_, max_iterations_);
+    cache.fingerprint = 0;
+    used_backend_ = type;
+    reused_analysis_ = false;
+    has_statistics_ = false;
+    low_rank_updated_ = false;
+    update_rank_ = 0;
+
+    return cache.backend->Compute(A);
+}
+
+template <typename Scalar>
+bool MNAsolver::factorize(BackendCache<Scalar>& cache, const SparseMatrix<Scalar>& A) {
+    /*
+    The symbolic analysis (fill-reducing ordering, elimination
+    tree, pattern of the factors) of the previous solve is kept
+    and reused when A has the same sparsity pattern, so only
+    the numeric factorization is redone. Adding or removing
+    components or nodes changes the pattern fingerprint, which
+    invalidates the cached analysis. Every scalar type keeps
+    its own analysis.
+    */
+    std::uint64_t fingerprint = PatternFingerprint(A);
+
+    SolverBackendType type = backend_type_;
+    if ( type == AUTO_BACKEND ) {
+        type = resolveBackend(A, fingerprint);
+    }
+
+    reused_analysis_ = cache.backend && cache.backend->GetType() == type && cache.fingerprint == fingerprint
+        && cache.ordering == ordering_ && cache.max_rank == max_rank_;
+
+    if ( !reused_analysis_ ) {
+        cache.backend = CreateBackend<Scalar>(type, ordering_);
+        if ( max_rank_ > 0 && !cache.backend->IsIterative() ) {
+            cache.backend.reset(new LowRankBackend<Scalar>(std::move(cache.backend), max_rank_));
+        }
+        cache.backend->Analyze(A);
+        cache.fingerprint = fingerprint;
+        cache.ordering = ordering_;
+        cache.max_rank = max_rank_;
+        if ( fill_statistics_ ) {
+            statistics_ = AnalyzeFill(A, ordering_ == AUTO_ORDERING ? DefaultOrdering(type) : ordering_);
+        }
+    }
+    has_statistics_ = fill_statistics_;
+    cache.backend->SetTolerance(iterative_tolerance_, max_iterations_);
+    used_backend_ = type;
+
+    bool factored = cache.backend->Factorize(A);
+    const LowRankBackend<Scalar>* low_rank = dynamic_cast<const LowRankBackend<Scalar>*>(cache.backend.get());
+    low_rank_updated_ = low_rank && low_rank->IsUpdated();
+    update_rank_ = low_rank ? low_rank->GetRank() : 0;
+    return factored;
+}
+
+template <typename Scalar>
+bool MNAsolver::solveIslands(
+        const SparseMatrix<Scalar>& A,
+        const Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z,
+        const std::vector<int>& islands,
+        int count
+    ) {
+    /*
+    Splits A into its diagonal blocks, one per island, keeping
+    the order of the rows within each. Entries that couple two
+    islands must be explicit zeros, as capacitors leave at DC,
+    otherwise the islands do not match A and false is returned.
+
+    The islands are handed out to the workers largest first
+    from a shared counter. Each worker factors its blocks with
+    the backend kept for that island and writes the solution
+    into the island's rows of x_. The backends are analyzed
+    again only when the pattern of A changes.
+    */
+    typedef Matrix<Scalar, Dynamic, 1> Vector;
+    const int n = A.rows();
+    if ( count < 1 || int(islands.size()) != n || z.rows() != n ) {
+        return false;
+    }
+
+    std::vector<int> local(n);
+    std::vector<std::vector<int>> rows(count);
+    for ( int row = 0; row < n; row++ ) {
+        if ( islands[row] < 0 || islands[row] >= count ) {
+            return false;
+        }
+        local[row] = rows[islands[row]].size();
+        rows[islands[row]].push_back(row);
+    }
+    std::vector<std::vector<Triplet<Scalar>>> triplets(count);
+    for ( int col = 0; col < A.outerSize(); col++ ) {
+        for ( typename SparseMatrix<Scalar>::InnerIterator it(A, col); it; ++it ) {
+            if ( islands[it.row()] != islands[col] ) {
+                if ( it.value() != Scalar(0) ) {
+                    return false;
+                }
+                continue;
+            }
+            triplets[islands[col]].push_back(Triplet<Scalar>(local[it.row()], local[col], it.value()));
+        }
+    }
 
-    x_ = A.inverse()*z;
+    BackendCache<Scalar>& backends = cache<Scalar>();
+    std::uint64_t fingerprint = PatternFingerprint(A);
+    reused_analysis_ = backends.islands.size() == size_t(count) && backends.islands_fingerprint == fingerprint
+        && backends.islands_type == backend_type_ && backends.islands_ordering == ordering_;
+    if ( !reused_analysis_ ) {
+        backends.islands.clear();
+        backends.islands.resize(count);
+        backends.islands_fingerprint = fingerprint;
+        backends.islands_type = backend_type_;
+        backends.islands_ordering = ordering_;
+    }
+
+    std::vector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&rows](int a, int b) { return rows[a].size() > rows[b].size(); });
+
+    x_.setZero(n);
+    std::atomic<int> next(0);
+    std::atomic<bool> failed(false);
+    std::mutex statistics;
+    int iterations = 0;
+    double error = 0;
 
-    node_voltages_.clear();
-    voltage_source_currents_.clear();
-    passive_component_currents_.clear();
+    auto worker = [&]() {
+        SparseMatrix<Scalar> block;
+        Vector b;
+        Vector x;
+        for ( int k = next++; k < count; k = next++ ) {
+            const std::vector<int>& island = rows[order[k]];
+            block.resize(island.size(), island.size());
+            block.setFromTriplets(triplets[order[k]].begin(), triplets[order[k]].end());
+
+            std::unique_ptr<SolverBackend<Scalar>>& backend = backends.islands[order[k]];
+            if ( !reused_analysis_ ) {
+                SolverBackendType type = backend_type_ == AUTO_BACKEND ? SelectBackend(AnalyzeMatrix(block)) : backend_type_;
+                backend = CreateBackend<Scalar>(type, ordering_);
+                backend->Analyze(block);
+            }
+            backend->SetTolerance(iterative_tolerance_, max_iterations_);
+
+            if ( !backend->Factorize(block) ) {
+                failed = true;
+                continue;
+            }
+            b = z(island).template cast<Scalar>();
+            x = backend->Solve(b);
+            if ( !backend->Converged() ) {
+                failed = true;
+            }
+            for ( size_t i = 0; i < island.size(); i++ ) {
+                x_(island[i]) = x(i);
+            }
+            if ( backend->IsIterative() ) {
+                std::lock_guard<std::mutex> lock(statistics);
+                iterations += backend->GetIterations();
+                error = std::max(error, backend->GetError());
+            }
+        }
+    };
 
-    for ( auto const& i : node_indexes ) {
-        node_voltages_[ i.first ] = x_( i.second );
+    int threads = threads_ > 0 ? threads_ : int(std::thread::hardware_concurrency());
+    threads = std::max(1, std::min(threads, count));
+    std::vector<std::thread> pool;
+    for ( int t = 1; t < threads; t++ ) {
+        pool.push_back(std::thread(worker));
     }
-    for ( auto const& i : voltage_source_indexes ) {
-        voltage_source_currents_[ i.first ] = x_( i.second );
+    worker();
+    for ( auto& thread : pool ) {
+        thread.join();
     }
-    for ( auto const& i : inductor_indexes ) {
-        passive_component_currents_[ i.first ] = x_( i.second );
+
+    // the largest island names the backend
+    used_backend_ = backends.islands[order[0]] ? backends.islands[order[0]]->GetType() : backend_type_;
+    island_count_ = count;
+    real_ = !NumTraits<Scalar>::IsComplex;
+    refined_ = false;
+    refinement_ = RefinementResult();
+    iterative_ = backends.islands[order[0]] && backends.islands[order[0]]->IsIterative();
+    iterations_ = iterations;
+    iterative_error_ = error;
+    has_statistics_ = false;
+    low_rank_updated_ = false;
+    update_rank_ = 0;
+    solved_ = !failed && x_.allFinite();
+    return true;
+}
+
+template <typename Scalar>
+SolverBackendType MNAsolver::resolveBackend(const SparseMatrix<Scalar>& A, std::uint64_t fingerprint) const {
+    /*
+    Uses the properties detected during matrix construction
+    when they describe A, otherwise analyzes A here.
+    */
+    if ( properties_.dimension == A.rows() && properties_.nonzeros == A.nonZeros()
+            && properties_.fingerprint == fingerprint ) {
+        return SelectBackend(properties_);
     }
+    return SelectBackend(AnalyzeMatrix(A));
+}
+
+#define INSTANTIATE_SOLVE(Scalar) \
+    template void MNAsolver::solveSteady<Scalar>( \
+        const Matrix<Scalar, Dynamic, Dynamic>& A, \
+        const Matrix<NumTraits<Scalar>::Real, Dynamic, 1>& z, \
+        float omega, \
+        const std::map<std::string, int>& node_indexes, \
+        const std::map<std::string, int>& voltage_source_indexes, \
+        const std::map<std::string, int>& inductor_indexes \
+    ); \
+    template void MNAsolver::solveSteady<Scalar>( \
+        const SparseMatrix<Scalar>& A, \
+        const Matrix<NumTraits<Scalar>::Real, Dynamic, 1>& z, \
+        float omega, \
+        const std::map<std::string, int>& node_indexes, \
+        const std::map<std::string, int>& voltage_source_indexes, \
+        const std::map<std::string, int>& inductor_indexes \
+    );
+
+INSTANTIATE_SOLVE(float)
+INSTANTIATE_SOLVE(double)
+INSTANTIATE_SOLVE(cd)
+INSTANTIATE_SOLVE(std::complex<double>)
+
+void MNAsolver::setResults(
+        float omega,
+        const std::map<std::string, int>& node_indexes, 
+        const std::map<std::string, int>& voltage_source_indexes, 
+        const std::map<std::string, int>& inductor_indexes,
+        const Circuit* circuit
+    ) {
+    /*
+    A map that already has the names of the indexes, as after
+    solving the same circuit before, only has its values
+    overwritten. Otherwise it is built again, and so are the
+    names of the result store, whose single column is the
+    solution.
+    */
+    branch_names_.clear();
+    branch_currents_.resize(0);
+
+    auto fill = [this](std::map<std::string, cd>& results, const std::map<std::string, int>& indexes) {
+        bool same = results.size() == indexes.size() && std::equal(results.begin(), results.end(), indexes.begin(),
+            [](const std::pair<const std::string, cd>& a, const std::pair<const std::string, int>& b) {
+                return a.first == b.first;
+            });
+        if ( !same ) {
+            results.clear();
+            for ( auto const& i : indexes ) {
+                results.emplace_hint(results.end(), i.first, cd(0, 0));
+            }
+        }
+        auto it = results.begin();
+        for ( auto const& i : indexes ) {
+            (it++)->second = cd(x_(i.second));
+        }
+        return same;
+    };
+
+    bool same = fill(node_voltages_, node_indexes);
+    same = fill(voltage_source_currents_, voltage_source_indexes) && same;
+    same = fill(passive_component_currents_, inductor_indexes) && same;
+
+    if ( circuit ) {
+        if ( !same || results_.GetRows() != x_.rows() || results_.GetNodeRows() != circuit->GetNodeRows()
+                || results_.GetComponentCount() != circuit->GetComponentIdCount() ) {
+            results_.SetIndexes(*circuit);
+        }
+    } else if ( !same || results_.GetRows() != x_.rows() ) {
+        results_.SetIndexes(node_indexes, voltage_source_indexes, inductor_indexes, x_.rows());
+    }
+    if ( results_.GetColumns() != 1 ) {
+        results_.Resize(std::vector<float>(1, omega));
+    }
+    results_.SetPoint(0, omega);
+    results_.Column(0) = x_.cast<cd>();
+    results_.Currents(0).setZero();
 }
 
 std::ostream &operator<<(std::ostream& out, const MNAsolver& solver) {
@@ -41,132 +513,152 @@ std::ostream &operator<<(std::ostream& out, const MNAsolver& solver) {
     return out.flush();
 }
 
-void MNAsolver::setCurrents( const std::list<std::shared_ptr<Component>> components, float omega ) {
-    // int omega = 0.0; //for ac circuit
-
-    std::map<std::pair<std::string, std::string>,std::list<std::shared_ptr<Component>>> parallel_components_map;
-
-    for ( auto const& component : components ) {
-        std::shared_ptr<Node> out = component->GetTerminalNode(OUTPUT);
-        std::shared_ptr<Node> in = component->GetTerminalNode(INPUT);
-
-        if (out == nullptr || in == nullptr) continue;  // other node is not connected
+void MNAsolver::setCurrents( const std::list<std::shared_ptr<Component>>& components, float omega ) {
+    /*
+    Branch currents of the passive components, I = Y (V_in - V_out),
+    computed in one pass over arrays of their admittances and
+    node rows. Ground is an extra zero at the end of the voltage
+    vector, so both terminals are plain gathers.
 
-        std::string out_name = component->GetTerminalNode(OUTPUT)->GetName();
-        std::string in_name = component->GetTerminalNode(INPUT)->GetName();
+    Currents of DC inductors are unknowns of the MNA system and
+    come with the solution. At DC the terminals of an inductor
+    are shorted, so a component whose nodes are joined by a path
+    of inductors carries no current. Those are found with a
+    union-find over the inductor terminals rather than from
+    voltage differences that are zero only up to rounding.
 
-        auto found = parallel_components_map.find(std::make_pair(out_name, in_name));
+    The currents are also written to the current block of the
+    result store, by component id.
+    */
+    branch_names_.clear();
+    const int n = x_.rows();
 
-        if ( found == parallel_components_map.end() ) {
-            auto found2 = parallel_components_map.find(std::make_pair(in_name, out_name));
+    std::vector<int> parent;  // union-find over node ids, DC only
+    auto find = [&parent](int id) {
+        while ( parent[id] != id ) {
+            parent[id] = parent[parent[id]];
+            id = parent[id];
+        }
+        return id;
+    };
+    if ( omega == 0 ) {
+        for ( auto const& component : components ) {
+            std::shared_ptr<Node> out = component->GetTerminalNode(OUTPUT);
+            std::shared_ptr<Node> in = component->GetTerminalNode(INPUT);
+            if ( out == nullptr || in == nullptr || component->GetType() != INDUCTOR ) continue;
 
-            if ( found == parallel_components_map.end() ) {
-                parallel_components_map[std::make_pair(out_name, in_name)] = {component};
-            } else {
-                (*found2).second.push_back(component);
+            int size = std::max(out->GetId(), in->GetId()) + 1;
+            for ( int id = parent.size(); id < size; id++ ) {
+                parent.push_back(id);
             }
-        } else {
-            (*found).second.push_back(component);
+            parent[find(out->GetId())] = find(in->GetId());
         }
     }
+    auto shorted = [&](const std::shared_ptr<Node>& out, const std::shared_ptr<Node>& in) {
+        return out->GetId() < int(parent.size()) && in->GetId() < int(parent.size())
+            && find(out->GetId()) == find(in->GetId());
+    };
 
-    for ( auto const& obj : parallel_components_map ) {
-        cd total_admittance = cd(0,0);
-        bool short_circuit = false;
-
-       //calculate total admittance
-        for ( auto const& component : obj.second ) {
-            ComponentType type = component->GetType();
+    int ids = results_.GetComponentCount();
+    for ( auto const& component : components ) {
+        ids = std::max(ids, component->GetId() + 1);
+    }
+    if ( ids != results_.GetComponentCount() ) {
+        results_.SetComponentCount(ids);
+    }
+    VectorXcf stored = VectorXcf::Zero(ids);
 
-            switch ( type ) {
-                case RESISTOR:
-                    total_admittance += cd(1 / component->GetValue(), 0);  
-                    // Y = 1 / Z = 1 / R
-                    break;
-                case CAPACITOR:
-                    if (omega != 0) {
-                        total_admittance += cd(0, (component->GetValue() * omega));  
-                        // Y = 1 / Z = j*w*C
-                    }
-                    break;
-                case INDUCTOR:
-                    if (omega != 0) {
-                        total_admittance += cd(0, (- 1 / (component->GetValue() * omega)));  
-                        // Y = 1 / Z = -j / (w*L) 
-                        break;
-                    } else {
-                        short_circuit = true;
-                        break;
-                    }
-                default:
-                    break;
-            }
-        }
+    std::vector<int> outputs;
+    std::vector<int> inputs;
+    std::vector<int> branch_ids;
+    std::vector<std::complex<double>> admittances;
+    outputs.reserve(components.size());
+    inputs.reserve(components.size());
+    admittances.reserve(components.size());
 
-        //
-        for ( auto const& component : obj.second ) {
-            ComponentType type = component->GetType();
-            std::string name = component->GetName();
+    for ( auto const& component : components ) {
+        std::shared_ptr<Node> out = component->GetTerminalNode(OUTPUT);
+        std::shared_ptr<Node> in = component->GetTerminalNode(INPUT);
 
-            cd out_value = cd(0,0); 
-            cd in_value = cd(0,0); 
+        if (out == nullptr || in == nullptr) continue;  // other node is not connected
 
-            if (component->GetTerminalNode(OUTPUT)->GetType() != GROUND) {
-                out_value = node_voltages_[component->GetTerminalNode(OUTPUT)->GetName()];
-            }
-            if (component->GetTerminalNode(INPUT)->GetType() != GROUND) {
-                in_value = node_voltages_[component->GetTerminalNode(INPUT)->GetName()];
-            }
-            cd V_difference = in_value - out_value;
-
-            if ( omega == 0 ) {
-                // if short circuit then other than inductor I = 0   
-                if ( short_circuit ) {
-                    switch ( type ) {
-                        case RESISTOR:
-                        case CAPACITOR:
-                            passive_component_currents_[name] = cd(0,0);
-                            break;
-                        case INDUCTOR:
-                            // DC inductor current is handled in mna
-                            break;
-                        default:
-                            break;
-                    }
-                } else {
-                    switch ( type ) {
-                        case RESISTOR:
-                            passive_component_currents_[name] = ( cd(1 / component->GetValue(), 0) / (total_admittance) ) * V_difference * total_admittance;
-                            break;
-                        case CAPACITOR:
-                            passive_component_currents_[name] = cd(0,0);
-                            break;
-                        default:
-                            break;
+        double value = component->GetValue();
+        std::complex<double> y = 0;
+        switch ( component->GetType() ) {
+            case RESISTOR:
+                y = value > 0 ? 1 / value : 0;  // Y = 1 / R
+                break;
+            case CAPACITOR:
+                y = std::complex<double>(0, value * omega);  // Y = jwC
+                break;
+            case INDUCTOR:
+                if ( omega == 0 ) {
+                    // DC current is in the solution
+                    if ( component->GetId() >= 0 && component->GetIndex() >= 0 && component->GetIndex() < n ) {
+                        stored(component->GetId()) = cd(x_(component->GetIndex()));
                     }
+                    continue;
                 }
-            } else {
-                // shorts currently only in DC 
-                switch ( type ) {
-                    case RESISTOR:
-                        passive_component_currents_[name] = ( cd(1 / component->GetValue(), 0) / (total_admittance)) * V_difference * total_admittance; 
-                        break;
-                    case CAPACITOR:
-                        passive_component_currents_[name] = ( cd(0, (component->GetValue() * omega)) / (total_admittance)) * V_difference * total_admittance;
-                        break;
-                    case INDUCTOR:
-                        passive_component_currents_[name] = ( cd(0, - 1 / (component->GetValue() * omega)) / (total_admittance)) * V_difference * total_admittance;
-                        break;
-                    default:
-                        break;
-                }
-            }
+                y = value > 0 ? std::complex<double>(0, -1 / (value * omega)) : 0;  // Y = 1 / (jwL)
+                break;
+            default:
+                continue;  // sources have no admittance
         }
+        if ( omega == 0 && shorted(out, in) ) {
+            y = 0;
+        }
+
+        int out_index = out->GetIndex();
+        int in_index = in->GetIndex();
+        outputs.push_back(out_index >= 0 && out_index < n ? out_index : n);
+        inputs.push_back(in_index >= 0 && in_index < n ? in_index : n);
+        admittances.push_back(y);
+        branch_names_.push_back(component->GetName());
+        branch_ids.push_back(component->GetId());
+    }
+
+    VectorXcd voltages(n + 1);
+    voltages << x_, 0;
+    Map<const ArrayXcd> y(admittances.data(), admittances.size());
+    branch_currents_ = y * (voltages(inputs).array() - voltages(outputs).array());
+    for ( size_t k = 0; k < branch_ids.size(); k++ ) {
+        if ( branch_ids[k] >= 0 ) {
+            stored(branch_ids[k]) = cd(branch_currents_(k));
+        }
+    }
+    if ( results_.GetColumns() > 0 ) {
+        results_.Currents(0) = stored;
     }
 }
 
+const std::map<std::string, cd> MNAsolver::GetComponentCurrents() const {
+    std::map<std::string, cd> currents = passive_component_currents_;
+    for ( size_t k = 0; k < branch_names_.size(); k++ ) {
+        currents[branch_names_[k]] = cd(branch_currents_(k));
+    }
+    return currents;
+}
+
 std::ostream& MNAsolver::resultListed(std::ostream &out) {
     out << " Result: " << std::endl;
+    out << "Solver backend: " << GetBackendName() << std::endl;
+    if ( iterative_ ) {
+        out << "Iterations: " << iterations_ << ", residual " << iterative_error_
+            << ", time " << solve_time_ << " s" << std::endl;
+    }
+    if ( has_statistics_ ) {
+        out << statistics_ << std::endl;
+    }
+    if ( low_rank_updated_ ) {
+        out << "Low-rank update of " << update_rank_ << " rows" << std::endl;
+    }
+    if ( island_count_ > 1 ) {
+        out << "Solved as " << island_count_ << " islands" << std::endl;
+    }
+    if ( refined_ ) {
+        out << "Iterative refinement: " << refinement_.steps << " steps, residual "
+            << refinement_.residual << std::endl;
+    }
 
     for(auto const& pair: node_voltages_){
         out << pair.first 
@@ -184,7 +676,7 @@ std::ostream& MNAsolver::resultListed(std::ostream &out) {
         << std::endl;
     }
     
-    for(auto const& pair: passive_component_currents_){
+    for(auto const& pair: GetComponentCurrents()){
         out << pair.first 
         << ": "
         << pair.second
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "ac_sweep.hpp"
+
+
+ACSweep::ACSweep(float start, float stop, int points, SweepSpacing spacing)
+    : omegas_(SweepPoints(start, stop, points, spacing)) { }
+
+
+std::vector<float> ACSweep::SweepPoints(float start, float stop, int points, SweepSpacing spacing) {
+    /*
+    Generates the angular frequencies of a sweep. As in SPICE,
+    points is the total number of points for a linear sweep and
+    the number of points per decade or octave otherwise.
+    */
+    std::vector<float> omegas;
+    if ( points <= 0 || start <= 0 || stop < start ) {
+        return omegas;
+    }
+
+    if ( spacing == LINEAR_SWEEP ) {
+        if ( points == 1 ) {
+            omegas.push_back(start);
+            return omegas;
+        }
+        double step = (double(stop) - double(start)) / (points - 1);
+        for ( int k = 0; k < points; k++ ) {
+            omegas.push_back(start + k * step);
+        }
+        return omegas;
+    }
+
+    double base = spacing == DECADE_SWEEP ? 10.0 : 2.0;
+    double intervals = std::log(double(stop) / double(start)) / std::log(base);
+    int count = int(std::floor(intervals * points + 1e-6)) + 1;
+    for ( int k = 0; k < count; k++ ) {
+        omegas.push_back(start * std::pow(base, double(k) / points));
+    }
+    return omegas;
+}
+
+bool ACSweep::Run(Circuit& circuit) {
+    /*
+    Indexes the circuit at the first frequency and solves every
+    point in parallel. Leaves the circuit constructed at the
+    first frequency of the sweep.
+    */
+    solved_ = false;
+    results_ = SimulationResults();
+    refinement_steps_ = 0;
+    max_residual_ = 0;
+    iterations_ = 0;
+
+    if ( omegas_.empty() ) {
+        return false;
+    }
+
+    circuit.SetOmega(omegas_.front());
+    circuit.ConstructMatrices();
+    if ( !circuit.Solveable() ) {
+        return false;
+    }
+
+    node_indexes_ = circuit.GetNodeIndexes();
+    voltage_source_indexes_ = circuit.GetVoltageSourceIndexes();
+
+    const SparseMatrix<cd> pattern = circuit.GetSparseAMatrix();
+    const int points = omegas_.size();
+
+    SolverBackendType type = backend_type_;
+    if ( type == AUTO_BACKEND ) {
+        type = SelectBackend(circuit.GetMatrixProperties());
+    }
+
+    results_.SetIndexes(circuit);
+    results_.Resize(omegas_);
+
+    /*
+    Branch currents of the passive components, I = Y(w) (V_in - V_out)
+    at every point. Ground is an extra zero after the solution, so
+    both terminals are plain gathers.
+    */
+    const int n = pattern.rows();
+    std::vector<int> branch_ids;
+    std::vector<ComponentType> branch_types;
+    std::vector<double> branch_values;
+    std::vector<int> outputs;
+    std::vector<int> inputs;
+    for ( auto const& component : circuit.GetComponents() ) {
+        ComponentType type = component->GetType();
+        std::shared_ptr<Node> out = component->GetTerminalNode(OUTPUT);
+        std::shared_ptr<Node> in = component->GetTerminalNode(INPUT);
+        if ( !out || !in || component->GetId() < 0 ) continue;
+        if ( type != RESISTOR && type != CAPACITOR && type != INDUCTOR ) continue;
+        branch_ids.push_back(component->GetId());
+        branch_types.push_back(type);
+        branch_values.push_back(component->GetValue());
+        outputs.push_back(out->GetIndex() >= 0 && out->GetIndex() < n ? out->GetIndex() : n);
+        inputs.push_back(in->GetIndex() >= 0 && in->GetIndex() < n ? in->GetIndex() : n);
+    }
+
+    std::atomic<int> next(0);
+    std::atomic<bool> failed(false);
+    std::mutex refinement;
+
+    // points whose column is written, the warm starts of an iterative backend
+    std::unique_ptr<std::atomic<bool>[]> solved(new std::atomic<bool>[points]);
+    for ( int k = 0; k < points; k++ ) {
+        solved[k] = false;
+    }
+    auto nearest = [&](int k) {
+        for ( int d = 1; d < points; d++ ) {
+            if ( k - d >= 0 && solved[k - d] ) return k - d;
+            if ( k + d < points && solved[k + d] ) return k + d;
+            if ( k - d < 0 && k + d >= points ) break;
+        }
+        return -1;
+    };
+
+    auto worker = [&]() {
+        // every worker has its own factorization and assembly buffers
+        std::unique_ptr<SolverBackend<cd>> backend = CreateBackend<cd>(type);
+        backend->SetTolerance(iterative_tolerance_, max_iterations_);
+        backend->Analyze(pattern);
+
+        SparseMatrix<cd> A;
+        VectorXf z;
+        SparseMatrix<std::complex<double>> A_double;
+        VectorXd z_double;
+        VectorXcd x;
+        VectorXcf guess;
+        VectorXcd voltages(n + 1);
+        int steps = 0;
+        int iterations = 0;
+        double residual = 0;
+
+        for ( int k = next++; k < points; k = next++ ) {
+            if ( mixed_precision_ ) {
+                circuit.AssembleMatrices(omegas_[k], A_double, z_double);
+                A = A_double.cast<cd>();
+            } else {
+                circuit.AssembleMatrices(omegas_[k], A, z);
+            }
+            if ( !backend->Factorize(A) ) {
+                failed = true;
+                continue;
+            }
+            if ( mixed_precision_ ) {
+                RefinementResult result = SolveRefined(*backend, A_double, VectorXcd(z_double.cast<std::complex<double>>()), x);
+                results_.Column(k) = x.cast<cd>();
+                steps += result.steps;
+                residual = std::max(residual, result.residual);
+            } else if ( backend->IsIterative() ) {
+                // start from the solution of the nearest frequency solved so far
+                int start = nearest(k);
+                if ( start >= 0 ) {
+                    guess = results_.GetColumn(start);
+                } else {
+                    guess.resize(0);
+                }
+                results_.Column(k) = backend->SolveWithGuess(z.cast<cd>(), guess);
+                iterations += backend->GetIterations();
+                if ( !backend->Converged() ) {
+                    failed = true;
+                }
+            } else {
+                results_.Column(k) = backend->Solve(z.cast<cd>());
+            }
+
+            voltages << results_.GetColumn(k).cast<std::complex<double>>(), 0;
+            Map<VectorXcf> currents = results_.Currents(k);
+            const double omega = omegas_[k];
+            for ( size_t b = 0; b < branch_ids.size(); b++ ) {
+                double value = branch_values[b];
+                std::complex<double> y = 0;
+                switch ( branch_types[b] ) {
+                    case RESISTOR:
+                        y = value > 0 ? 1 / value : 0;  // Y = 1 / R
+                        break;
+                    case CAPACITOR:
+                        y = std::complex<double>(0, value * omega);  // Y = jwC
+                        break;
+                    default:
+                        y = value > 0 ? std::complex<double>(0, -1 / (value * omega)) : 0;  // Y = 1 / (jwL)
+                        break;
+                }
+                currents(branch_ids[b]) = cd(y * (voltages(inputs[b]) - voltages(outputs[b])));
+            }
+            solved[k] = true;
+        }
+
+        std::lock_guard<std::mutex> lock(refinement);
+        refinement_steps_ += steps;
+        iterations_ += iterations;
+        max_residual_ = std::max(max_residual_, residual);
+    };
+
+    int threads = threads_ > 0 ? threads_ : int(std::thread::hardware_concurrency());
+    threads = std::max(1, std::min(threads, points));
+
+    std::vector<std::thread> pool;
+    for ( int t = 1; t < threads; t++ ) {
+        pool.push_back(std::thread(worker));
+    }
+    worker();
+    for ( auto& thread : pool ) {
+        thread.join();
+    }
+
+    solved_ = !failed && GetxMatrix().allFinite();
+    return solved_;
+}
+
+const MatrixXcf ACSweep::GetNodeVoltages() const {
+    return GetxMatrix().topRows(node_indexes_.size());
+}
+
+const MatrixXcf ACSweep::GetVoltageSourceCurrents() const {
+    return GetxMatrix().bottomRows(results_.GetRows() - node_indexes_.size());
+}
+
+const VectorXcf ACSweep::GetNodeResponse(const std::string& node) const {
+    int index = results_.GetIndex(node);
+    if ( index < 0 || results_.GetType(index) != NODE_VOLTAGE ) {
+        return VectorXcf::Zero(results_.GetColumns());  // ground or unknown node
+    }
+    return results_.GetTrace(index);
+}
+
+const VectorXcf ACSweep::GetComponentResponse(const std::string& component) const {
+    int id = results_.GetComponentId(component);
+    if ( id < 0 ) {
+        return VectorXcf::Zero(results_.GetColumns());  // unknown component
+    }
+    return results_.GetCurrentTrace(id);
+}
+
+std::ostream& ACSweep::resultListed(std::ostream &out) {
+    out << " Sweep result: " << std::endl;
+    if ( iterations_ > 0 ) {
+        out << "Iterations: " << iterations_ << std::endl;
+    }
+    if ( mixed_precision_ ) {
+        out << "Iterative refinement: " << refinement_steps_ << " steps, max residual "
+            << max_residual_ << std::endl;
+    }
+
+    out << "w";
+    for ( auto const& pair : node_indexes_ ) {
+        out << " " << pair.first << "[V]";
+    }
+    for ( auto const& pair : voltage_source_indexes_ ) {
+        out << " " << pair.first << "[A]";
+    }
+    out << std::endl;
+
+    for ( int k = 0; k < results_.GetColumns(); k++ ) {
+        out << omegas_[k];
+        for ( auto const& pair : node_indexes_ ) {
+            out << " " << results_.Get(pair.second, k);
+        }
+        for ( auto const& pair : voltage_source_indexes_ ) {
+            out << " " << results_.Get(pair.second, k);
+        }
+        out << std::endl;
+    }
+
+    out << std::endl;
+    return out;
+}
@@ -10,4 +10,8 @@ ActiveComponent::ActiveComponent(const std::string &name,
 
 ComponentClass ActiveComponent::GetClass() const {
     return ACTIVE;
-};
\ No newline at end of file
+};
+
+float ActiveComponent::GetValueAt(float time) const {
+    return waveform_ ? waveform_->GetValue(time) : GetValue();
+}
\ No newline at end of file
@@ -14,6 +14,7 @@ float Capacitor::GetValue() const {
 
 void Capacitor::SetValue(float newval) {
     capacitance_ = newval;
+    ValueChanged();
 }
 
 std::complex<float> Capacitor::GetAdmittance(const float w) const {
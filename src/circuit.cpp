@@ -1,7 +1,10 @@
-#include <set>
+#include <algorithm>
+#include <cassert>
 #include <string>
+#include <vector>
 
 #include "circuit.hpp"
+#include "active_component.hpp"
 
 const std::list<std::shared_ptr<Component>>& Circuit::GetComponents() const {
     return components_;
@@ -9,68 +12,834 @@ const std::list<std::shared_ptr<Component>>& Circuit::GetComponents() const {
 
 void Circuit::RemoveComponent(std::shared_ptr<Component> component) {
     components_.remove(component);
+    component->SetChangeLog(nullptr);
+    changes_->topology = true;
 }
 
-void Circuit::RemoveUnnecessaryNodes() {
-    std::set<std::string> used_nodes;
-    for ( auto comp : components_ ) {
-        if (comp->GetTerminalNode(INPUT)) {
-            used_nodes.insert(comp->GetTerminalNode(INPUT)->GetName());
+std::vector<bool> Circuit::UsedNodes() const {
+    // by node id, true for the nodes a terminal of a component or element is on
+    std::vector<bool> used(nodes_.size(), false);
+    for ( auto const& comp : components_ ) {
+        for ( auto terminal : { INPUT, OUTPUT } ) {
+            std::shared_ptr<Node> node = comp->GetTerminalNode(terminal);
+            if ( node && node->GetId() >= 0 && node->GetId() < int(nodes_.size()) ) {
+                used[node->GetId()] = true;
+            }
         }
-        if (comp->GetTerminalNode(OUTPUT)) {
-            used_nodes.insert(comp->GetTerminalNode(OUTPUT)->GetName());
+    }
+    for ( int type = 0; type < COMPONENT_TYPE_COUNT; type++ ) {
+        const ComponentStore::Arrays& arrays = elements_.Get(ComponentType(type));
+        for ( size_t k = 0; k < arrays.values.size(); k++ ) {
+            if ( arrays.inputs[k] >= 0 ) used[arrays.inputs[k]] = true;
+            if ( arrays.outputs[k] >= 0 ) used[arrays.outputs[k]] = true;
         }
     }
-    auto itr = nodes_.begin();
-    while (itr != nodes_.end()) {
-        auto found = used_nodes.find((*itr).first);
-        if ( found == used_nodes.end() ) {
-            nodes_.erase(itr++);
-        } else {
-            ++itr;
+    return used;
+}
+
+void Circuit::RemoveUnnecessaryNodes() {
+    std::vector<bool> used = UsedNodes();
+    for ( size_t id = 0; id < nodes_.size(); id++ ) {
+        if ( nodes_[id] && !used[id] ) {
+            node_ids_.erase(nodes_[id]->GetName());
+            nodes_[id].reset();
+            changes_->topology = true;
         }
     }
 }
 
 void Circuit::ConstructMatrices() {
+    /*
+    When only component values changed since the last call, the
+    edited components are restamped in place. Otherwise the
+    matrices are built from scratch.
+    */
+    if ( !RestampChanges() ) {
+        BuildMatrices();
+    }
+}
+
+void Circuit::BuildMatrices() {
     RemoveUnnecessaryNodes();
-    //generate index map based on nodes
     // works only on circuits with ac or dc sources only
     node_indexes_.clear();
     voltage_source_indexes_.clear();
     inductor_indexes_.clear();
 
-    int inductor_sc_count = 0;
     int l = 0;  // inductor count
     int m = 0; // voltage source count
     int n = 0; // node count
-    int voltage_sources_count = 0;
 
-    float omega = omega_;
-
-    for ( auto const& i : nodes_ ) {
-        if ( i.second->GetType() != GROUND ) {
-            node_indexes_[ i.first ] = n;
-            n++;
+    /*
+    Node rows are numbered in the alphabetical order of the names,
+    as results and netlists refer to them, and stored in the nodes
+    so that stamping does not look names up.
+    */
+    std::vector<std::shared_ptr<Node>> ordered;
+    for ( auto const& node : nodes_ ) {
+        if ( !node ) continue;
+        node->SetIndex(-1);
+        if ( node->GetType() != GROUND ) {
+            ordered.push_back(node);
         }
     }
+    std::sort(ordered.begin(), ordered.end(),
+        [](const std::shared_ptr<Node>& a, const std::shared_ptr<Node>& b) { return a->GetName() < b->GetName(); });
+    node_rows_.assign(nodes_.size(), -1);
+    for ( auto const& node : ordered ) {
+        node->SetIndex(n);
+        node_rows_[node->GetId()] = n;
+        node_indexes_[ node->GetName() ] = n;
+        n++;
+    }
 
-    // count inductors and voltage sources
-    for ( auto it : components_ ) {
+    // elements with both terminals connected get branch rows like components
+    auto connected = [](const ComponentStore::Arrays& arrays, size_t k) {
+        return arrays.inputs[k] >= 0 && arrays.outputs[k] >= 0;
+    };
+    for ( auto& rows : element_rows_ ) {
+        rows.clear();
+    }
+
+    // inductor rows follow the node rows
+    for ( auto const& it : components_ ) {
+        it->SetIndex(-1);
         if ( !it->GetTerminalNode(OUTPUT) || !it->GetTerminalNode(INPUT) ) continue;
         
-        if ( it->GetType() == INDUCTOR && omega == 0) {
+        if ( it->GetType() == INDUCTOR && omega_ == 0) {
+            it->SetIndex(l + n);
             inductor_indexes_[it->GetName()] = l + n;
             l += 1;
         }
+    }
+    const ComponentStore::Arrays& inductors = elements_.Get(INDUCTOR);
+    element_rows_[INDUCTOR].assign(inductors.values.size(), -1);
+    for ( size_t k = 0; k < inductors.values.size() && omega_ == 0; k++ ) {
+        if ( !connected(inductors, k) ) continue;
+        element_rows_[INDUCTOR][k] = l + n;
+        std::string name = elements_.GetName(INDUCTOR, k);
+        if ( !name.empty() ) {
+            inductor_indexes_[name] = l + n;
+        }
+        l += 1;
+    }
+
+    // voltage source rows come after the node and inductor rows
+    for ( auto const& it : components_ ) {
+        if ( !it->GetTerminalNode(OUTPUT) || !it->GetTerminalNode(INPUT) ) continue;
+
         if ( it->GetType() == VOLTAGE_SOURCE ) {
+            it->SetIndex(n + l + m);
+            voltage_source_indexes_[it->GetName()] = n + l + m;
             m += 1;
         }
     }
+    const ComponentStore::Arrays& sources = elements_.Get(VOLTAGE_SOURCE);
+    element_rows_[VOLTAGE_SOURCE].assign(sources.values.size(), -1);
+    for ( size_t k = 0; k < sources.values.size(); k++ ) {
+        if ( !connected(sources, k) ) continue;
+        element_rows_[VOLTAGE_SOURCE][k] = n + l + m;
+        std::string name = elements_.GetName(VOLTAGE_SOURCE, k);
+        if ( !name.empty() ) {
+            voltage_source_indexes_[name] = n + l + m;
+        }
+        m += 1;
+    }
+
+    dimension_ = n + m + l;
+
+    FindIslands();
+    FindReduction();
+    BuildStampMatrices();
+    FinishMatrices();
+}
+
+void Circuit::FindIslands() {
+    /*
+    Union-find over the node ids, joined by every component that
+    couples the rows of its terminals. Ground is left out, so
+    parts that only share ground stay apart, and a part is
+    grounded when one of its coupling components has a terminal
+    at ground. The branch row of an inductor or voltage source
+    is in the island of its nodes.
+    */
+    const bool dc = omega_ == 0;
+    std::vector<int> parent(nodes_.size());
+    for ( size_t id = 0; id < parent.size(); id++ ) {
+        parent[id] = id;
+    }
+    auto find = [&parent](int id) {
+        while ( parent[id] != id ) {
+            parent[id] = parent[parent[id]];
+            id = parent[id];
+        }
+        return id;
+    };
+    auto ground = [this](int id) {
+        return nodes_[id]->GetType() == GROUND;
+    };
+    auto couples = [dc](ComponentType type) {
+        return type != CURRENT_SOURCE && !(dc && type == CAPACITOR);
+    };
+
+    std::vector<int> grounded_ids;
+    auto join = [&](int output, int input) {
+        if ( ground(output) && ground(input) ) {
+            return;
+        } else if ( ground(output) ) {
+            grounded_ids.push_back(input);
+        } else if ( ground(input) ) {
+            grounded_ids.push_back(output);
+        } else {
+            parent[find(output)] = find(input);
+        }
+    };
+
+    for ( auto const& it : components_ ) {
+        if ( !it->GetTerminalNode(OUTPUT) || !it->GetTerminalNode(INPUT) || !couples(it->GetType()) ) continue;
+        join(it->GetTerminalNode(OUTPUT)->GetId(), it->GetTerminalNode(INPUT)->GetId());
+    }
+    for ( int type = 0; type < COMPONENT_TYPE_COUNT; type++ ) {
+        if ( !couples(ComponentType(type)) ) continue;
+        const ComponentStore::Arrays& arrays = elements_.Get(ComponentType(type));
+        for ( size_t k = 0; k < arrays.values.size(); k++ ) {
+            if ( arrays.inputs[k] < 0 || arrays.outputs[k] < 0 ) continue;
+            join(arrays.outputs[k], arrays.inputs[k]);
+        }
+    }
+    std::vector<bool> grounded(nodes_.size(), false);
+    for ( int id : grounded_ids ) {
+        grounded[find(id)] = true;
+    }
+
+    // islands are numbered in the order of their first row
+    islands_.assign(dimension_, -1);
+    island_count_ = 0;
+    std::vector<int> island_of_root(nodes_.size(), -1);
+    std::vector<bool> floating;
+    for ( size_t id = 0; id < nodes_.size(); id++ ) {
+        if ( node_rows_[id] < 0 ) continue;
+        int root = find(id);
+        if ( island_of_root[root] < 0 ) {
+            island_of_root[root] = island_count_++;
+            floating.push_back(!grounded[root]);
+        }
+        islands_[node_rows_[id]] = island_of_root[root];
+    }
+
+    auto branch = [&](int row, int output, int input) {
+        if ( row < 0 ) return;
+        int id = ground(output) ? input : output;
+        if ( ground(id) ) {
+            islands_[row] = island_count_++;  // both terminals at ground
+            floating.push_back(false);
+        } else {
+            islands_[row] = islands_[node_rows_[id]];
+        }
+    };
+    for ( auto const& it : components_ ) {
+        if ( !it->GetTerminalNode(OUTPUT) || !it->GetTerminalNode(INPUT) ) continue;
+        if ( it->GetType() == VOLTAGE_SOURCE || (it->GetType() == INDUCTOR && dc) ) {
+            branch(it->GetIndex(), it->GetTerminalNode(OUTPUT)->GetId(), it->GetTerminalNode(INPUT)->GetId());
+        }
+    }
+    ComponentType types[] = {INDUCTOR, VOLTAGE_SOURCE};
+    for ( ComponentType type : types ) {
+        const ComponentStore::Arrays& arrays = elements_.Get(type);
+        for ( size_t k = 0; k < element_rows_[type].size(); k++ ) {
+            branch(element_rows_[type][k], arrays.outputs[k], arrays.inputs[k]);
+        }
+    }
+
+    floating_nodes_.clear();
+    for ( auto const& pair : node_indexes_ ) {
+        if ( floating[islands_[pair.second]] ) {
+            floating_nodes_.push_back(pair.first);
+        }
+    }
+
+    // a time step solves G + C / h, where capacitors connect their nodes as well
+    transient_floating_nodes_ = floating_nodes_;
+    if ( !dc || floating_nodes_.empty() ) {
+        return;
+    }
+    for ( auto const& it : components_ ) {
+        if ( !it->GetTerminalNode(OUTPUT) || !it->GetTerminalNode(INPUT) || it->GetType() != CAPACITOR ) continue;
+        join(it->GetTerminalNode(OUTPUT)->GetId(), it->GetTerminalNode(INPUT)->GetId());
+    }
+    const ComponentStore::Arrays& capacitors = elements_.Get(CAPACITOR);
+    for ( size_t k = 0; k < capacitors.values.size(); k++ ) {
+        if ( capacitors.inputs[k] < 0 || capacitors.outputs[k] < 0 ) continue;
+        join(capacitors.outputs[k], capacitors.inputs[k]);
+    }
+    grounded.assign(nodes_.size(), false);
+    for ( int id : grounded_ids ) {
+        grounded[find(id)] = true;
+    }
+    transient_floating_nodes_.clear();
+    for ( auto const& pair : node_indexes_ ) {
+        if ( !grounded[find(node_ids_.at(pair.first))] ) {
+            transient_floating_nodes_.push_back(pair.first);
+        }
+    }
+}
+
+void Circuit::FindReduction() {
+    /*
+    Classes of nodes shorted by DC inductors are found with a
+    union-find over the node ids, ground being one more vertex.
+    The inductors that join two classes are the edges of a
+    spanning forest, their currents are eliminated. An inductor
+    closing a loop of inductors keeps its row, which is singular
+    as it is in the full system. A voltage source between ground
+    and a class that is not at ground or fixed yet fixes the
+    voltage of the class and is a forest edge as well.
+
+    Every class that is not ground or fixed becomes one row, the
+    sum of the current laws of its nodes, in the order of the
+    first of its node rows. The current of a forest edge is
+    found from the law of its node on the leaf side once the
+    currents further out are known, so the edges are listed
+    leaves first.
+
+    The islands of the full rows are carried over to the rows
+    that remain. A circuit that would reduce to nothing is left
+    as it is.
+    */
+    reduction_attempted_ = reduce_topology_ && omega_ == 0;
+    reduced_ = reduction_attempted_;
+    reduced_index_.clear();
+    fixed_nodes_.clear();
+    eliminated_.clear();
+    if ( !reduced_ ) {
+        return;
+    }
+
+    const int ground = nodes_.size();  // every ground node is this vertex
+    std::vector<int> parent(nodes_.size() + 1);
+    for ( size_t id = 0; id < parent.size(); id++ ) {
+        parent[id] = id;
+    }
+    auto find = [&parent](int id) {
+        while ( parent[id] != id ) {
+            parent[id] = parent[parent[id]];
+            id = parent[id];
+        }
+        return id;
+    };
+    auto vertex = [this, ground](int id) {
+        return nodes_[id]->GetType() == GROUND ? ground : id;
+    };
 
-    A_ = MatrixXcf::Zero(n + m + l, n + m + l);  // initialize A matrix
-    z_ = VectorXf::Zero(m + n + l);  // initialize z vector
+    // branches with a current row: the row, its terminals and the coefficient of the current at the output
+    struct Branch {
+        int row;
+        int out;
+        int in;
+        double coefficient;
+    };
+    std::vector<Branch> inductors;
+    std::vector<Branch> sources;
+    for ( auto const& it : components_ ) {
+        if ( it->GetIndex() < 0 ) continue;
+        Branch branch = { it->GetIndex(), vertex(it->GetTerminalNode(OUTPUT)->GetId()),
+            vertex(it->GetTerminalNode(INPUT)->GetId()), it->GetType() == INDUCTOR ? -1.0 : 1.0 };
+        (it->GetType() == INDUCTOR ? inductors : sources).push_back(branch);
+    }
+    ComponentType types[] = {INDUCTOR, VOLTAGE_SOURCE};
+    for ( ComponentType type : types ) {
+        const ComponentStore::Arrays& arrays = elements_.Get(type);
+        for ( size_t k = 0; k < element_rows_[type].size(); k++ ) {
+            if ( element_rows_[type][k] < 0 ) continue;
+            Branch branch = { element_rows_[type][k], vertex(arrays.outputs[k]), vertex(arrays.inputs[k]),
+                type == INDUCTOR ? -1.0 : 1.0 };
+            (type == INDUCTOR ? inductors : sources).push_back(branch);
+        }
+    }
 
+    std::vector<std::vector<std::pair<int, int>>> forest(parent.size());  // (vertex, branch) by vertex
+    std::vector<Branch> edges;
+    auto add_edge = [&](const Branch& branch) {
+        forest[branch.out].push_back(std::make_pair(branch.in, int(edges.size())));
+        forest[branch.in].push_back(std::make_pair(branch.out, int(edges.size())));
+        edges.push_back(branch);
+    };
+    for ( const Branch& inductor : inductors ) {
+        int out = find(inductor.out);
+        int in = find(inductor.in);
+        if ( out != in ) {
+            parent[out] = in;
+            add_edge(inductor);
+        }
+    }
+    std::vector<int> fixed_by(parent.size(), -1);  // edge of the source fixing a class
+    for ( const Branch& source : sources ) {
+        int out = find(source.out);
+        int in = find(source.in);
+        int grounded = find(ground);
+        if ( (out == grounded) == (in == grounded) ) continue;
+        int fixed = out == grounded ? in : out;
+        if ( fixed_by[fixed] >= 0 ) continue;
+        fixed_by[fixed] = edges.size();
+        add_edge(source);
+    }
+
+    // rows of the classes that remain, then of the currents that are not eliminated
+    std::vector<int> row_node(dimension_, -1);
+    for ( size_t id = 0; id < nodes_.size(); id++ ) {
+        if ( node_rows_[id] >= 0 ) {
+            row_node[node_rows_[id]] = id;
+        }
+    }
+    std::vector<bool> eliminated(dimension_, false);
+    for ( const Branch& edge : edges ) {
+        eliminated[edge.row] = true;
+    }
+    reduced_index_.assign(dimension_, -1);
+    std::vector<int> class_row(parent.size(), -1);
+    int rows = 0;
+    for ( int row = 0; row < dimension_; row++ ) {
+        if ( row_node[row] >= 0 ) {
+            int root = find(row_node[row]);
+            if ( root == find(ground) ) {
+                continue;
+            } else if ( fixed_by[root] >= 0 ) {
+                const Branch& source = edges[fixed_by[root]];
+                fixed_nodes_.push_back({ row, source.row, find(source.in) == find(ground) ? 1.0 : -1.0 });
+                continue;
+            }
+            if ( class_row[root] < 0 ) {
+                class_row[root] = rows++;
+            }
+            reduced_index_[row] = class_row[root];
+        } else if ( !eliminated[row] ) {
+            reduced_index_[row] = rows++;
+        }
+    }
+    if ( rows == 0 ) {
+        reduced_ = false;
+        reduced_index_.clear();
+        fixed_nodes_.clear();
+        return;
+    }
+    reduced_dimension_ = rows;
+
+    // breadth first from ground, then from the classes that do not reach it
+    std::vector<int> order;
+    std::vector<int> parent_edge(parent.size(), -1);
+    std::vector<bool> visited(parent.size(), false);
+    auto search = [&](int root) {
+        size_t head = order.size();
+        visited[root] = true;
+        order.push_back(root);
+        for ( ; head < order.size(); head++ ) {
+            int v = order[head];
+            for ( auto const& next : forest[v] ) {
+                if ( !visited[next.first] ) {
+                    visited[next.first] = true;
+                    parent_edge[next.first] = next.second;
+                    order.push_back(next.first);
+                }
+            }
+        }
+    };
+    search(ground);
+    for ( size_t v = 0; v < forest.size(); v++ ) {
+        if ( !visited[v] && !forest[v].empty() ) {
+            search(v);
+        }
+    }
+    auto row = [this, ground](int v) {
+        return v == ground ? -1 : node_rows_[v];
+    };
+    for ( auto it = order.rbegin(); it != order.rend(); ++it ) {
+        if ( parent_edge[*it] < 0 ) continue;
+        const Branch& edge = edges[parent_edge[*it]];
+        int other = edge.out == *it ? edge.in : edge.out;
+        double coefficient = edge.out == *it ? edge.coefficient : -edge.coefficient;
+        eliminated_.push_back({ edge.row, row(*it), row(other), coefficient, -coefficient });
+    }
+
+    int count = 0;
+    std::vector<int> renumbered(island_count_, -1);
+    std::vector<int> islands(rows, -1);
+    for ( int i = 0; i < dimension_; i++ ) {
+        int r = reduced_index_[i];
+        if ( r < 0 || islands[r] >= 0 ) continue;
+        if ( renumbered[islands_[i]] < 0 ) {
+            renumbered[islands_[i]] = count++;
+        }
+        islands[r] = renumbered[islands_[i]];
+    }
+    islands_.swap(islands);
+    island_count_ = count;
+}
+
+VectorXd Circuit::FixedVoltages() const {
+    // voltages of the eliminated nodes, zero elsewhere
+    VectorXd x = VectorXd::Zero(dimension_);
+    for ( const FixedNode& node : fixed_nodes_ ) {
+        x(node.row) = node.sign * s_(node.source);
+    }
+    return x;
+}
+
+void Circuit::ReduceMatrices() {
+    /*
+    Sums the entries of G into the reduced matrix through the
+    reduction plan, and the rows of s, less the currents the
+    fixed voltages drive, into z.
+    */
+    const int nonzeros = G_.nonZeros();
+    Map<ArrayXd>(G_reduced_.valuePtr(), G_reduced_.nonZeros()).setZero();
+    for ( int p = 0; p < nonzeros; p++ ) {
+        if ( reduction_plan_[p] >= 0 ) {
+            G_reduced_.valuePtr()[reduction_plan_[p]] += G_.valuePtr()[p];
+        }
+    }
+
+    VectorXd rhs = s_;
+    if ( !fixed_nodes_.empty() ) {
+        rhs -= G_ * FixedVoltages();
+    }
+    VectorXd z = VectorXd::Zero(reduced_dimension_);
+    for ( int i = 0; i < dimension_; i++ ) {
+        if ( reduced_index_[i] >= 0 ) {
+            z(reduced_index_[i]) += rhs(i);
+        }
+    }
+    z_reduced_ = z.cast<float>();
+    A_reduced_ = G_reduced_.cast<float>();
+}
+
+void Circuit::ExpandSolution(const VectorXd& reduced, VectorXd& x) const {
+    /*
+    The node voltages are read from the row of their class or
+    are the fixed voltages. The eliminated currents are then
+    found leaves first: the residual of the current law of the
+    leaf side node is the current of its forest edge, which is
+    then moved to the law of the other terminal.
+    */
+    if ( !reduced_ ) {
+        x = reduced;
+        return;
+    }
+    x = FixedVoltages();
+    for ( int i = 0; i < dimension_; i++ ) {
+        if ( reduced_index_[i] >= 0 ) {
+            x(i) = reduced(reduced_index_[i]);
+        }
+    }
+    if ( eliminated_.empty() ) {
+        return;
+    }
+    VectorXd residual = s_ - G_ * x;
+    for ( const EliminatedBranch& branch : eliminated_ ) {
+        double current = residual(branch.node) / branch.coefficient;
+        x(branch.branch) = current;
+        if ( branch.parent >= 0 ) {
+            residual(branch.parent) -= branch.parent_coefficient * current;
+        }
+    }
+}
+
+void Circuit::UpdateValues() {
+    /*
+    Restamps the current component values through the assembly
+    plan of the last ConstructMatrices: the stamp matrices keep
+    their pattern and storage, their values are zeroed and every
+    stamp entry is added at its planned offset. The source
+    vector is rebuilt the same way.
+    */
+    if ( !MatchesPlan() ) {
+        BuildMatrices();
+        return;
+    }
+
+    const int nonzeros = G_.nonZeros();
+    Map<ArrayXd>(G_.valuePtr(), nonzeros).setZero();
+    Map<ArrayXd>(C_.valuePtr(), nonzeros).setZero();
+    Map<ArrayXd>(Gamma_.valuePtr(), nonzeros).setZero();
+    s_.setZero();
+    s_elements_.setZero();
+
+    StampContext context;
+    context.dc = plan_dc_;
+    context.offsets = &assembly_plan_;
+    context.g_values = G_.valuePtr();
+    context.c_values = C_.valuePtr();
+    context.gamma_values = Gamma_.valuePtr();
+    StampValues(context);
+
+    if ( context.cursor != assembly_plan_.size() ) {
+        BuildMatrices();  // components were added or removed
+        return;
+    }
+    FinishMatrices();
+}
+
+bool Circuit::MatchesPlan() const {
+    return !changes_->topology && (omega_ == 0) == plan_dc_ && G_.rows() == dimension_
+        && (reduce_topology_ && omega_ == 0) == reduction_attempted_
+        && node_rows_.size() == nodes_.size()
+        && elements_.GetRevision() == plan_revision_;
+}
+
+bool Circuit::RestampChanges() {
+    /*
+    Restamps the components in the change log when nothing else
+    changed. The entries of a component are a contiguous run of
+    the assembly plan starting at its record: its old value is
+    stamped again with the opposite sign, then the new value on
+    top. Only the entries of A and z that were touched are
+    formed again, so the cost follows the number of edits. A
+    value edit keeps the pattern and symmetry of the matrix, so
+    its properties stay valid as long as no value turns
+    nonpositive.
+
+    Returns false when the circuit has to be built again.
+    */
+    if ( !MatchesPlan() ) {
+        return false;
+    }
+    if ( elements_.GetValueRevision() != plan_value_revision_ ) {
+        UpdateValues();  // element values have no log, restamp all of them
+        return true;
+    }
+
+    std::vector<int>& ids = changes_->values;
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    std::vector<int> entries;
+    std::vector<int> rows;
+    StampContext context;
+    context.dc = plan_dc_;
+    context.s = &s_;
+    context.offsets = &assembly_plan_;
+    context.g_values = G_.valuePtr();
+    context.c_values = C_.valuePtr();
+    context.gamma_values = Gamma_.valuePtr();
+    context.touched = &entries;
+    context.touched_rows = &rows;
+
+    auto stamp = [&context](const Component* component, float value) {
+        StampComponent(context, component->GetType(), component->GetTerminalNode(OUTPUT)->GetIndex(),
+            component->GetTerminalNode(INPUT)->GetIndex(), component->GetIndex(), value);
+    };
+
+    bool signs_kept = true;
+    for ( int id : ids ) {
+        if ( id < 0 || id >= int(stamp_records_.size()) || !stamp_records_[id].component ) {
+            continue;  // not connected, so not stamped
+        }
+        StampRecord& record = stamp_records_[id];
+        context.cursor = record.start;
+        context.scale = -1;
+        stamp(record.component, record.value);
+        context.cursor = record.start;
+        context.scale = 1;
+        record.value = record.component->GetValue();
+        stamp(record.component, record.value);
+        signs_kept = signs_kept && record.value > 0;
+    }
+    ids.clear();
+
+    if ( signs_kept && !reduced_ && omega_ == matrices_omega_ && IsSparse() == matrices_sparse_ ) {
+        UpdateEntries(entries, rows);
+    } else {
+        FinishMatrices();
+    }
+    return true;
+}
+
+void Circuit::UpdateEntries(const std::vector<int>& entries, const std::vector<int>& rows) {
+    /*
+    Forms the entries of A and z again at the given positions of
+    the value arrays and rows of s, as FinishMatrices would.
+    */
+    const int* outer = G_.outerIndexPtr();
+    const int* inner = G_.innerIndexPtr();
+    auto column = [outer, this](int position) {
+        return int(std::upper_bound(outer, outer + dimension_ + 1, position) - outer) - 1;
+    };
+
+    if ( real_ ) {
+        for ( int position : entries ) {
+            A_real_sparse_.valuePtr()[position] = float(G_.valuePtr()[position]);
+            if ( !matrices_sparse_ ) {
+                A_real_(inner[position], column(position)) = float(G_.valuePtr()[position]);
+            }
+        }
+        for ( int row : rows ) {
+            z_(row) = float(s_(row));
+        }
+        return;
+    }
+
+    const double omega = omega_;
+    for ( int position : entries ) {
+        cd value(float(G_.valuePtr()[position]),
+            float(omega * C_.valuePtr()[position] - Gamma_.valuePtr()[position] / omega));
+        A_sparse_.valuePtr()[position] = value;
+        if ( !matrices_sparse_ ) {
+            A_(inner[position], column(position)) = value;
+        }
+    }
+    for ( int row : rows ) {
+        z_(row) = float(s_(row) * RMS_SCALE);
+    }
+}
+
+void Circuit::FinishMatrices() {
+    /*
+    At DC A is just G, so there is nothing to assemble and
+    the matrix stays real. The complex matrices are only built
+    for AC. The sparse A is always kept, in the pattern of G so
+    that edits can be written into it in place, and a dense copy
+    only when the circuit is solved densely.
+    */
+    real_ = omega_ == 0;
+    matrices_omega_ = omega_;
+    matrices_sparse_ = IsSparse();
+    A_.resize(0, 0);
+    A_real_.resize(0, 0);
+
+    if ( real_ ) {
+        A_sparse_.resize(0, 0);
+        z_ = s_.cast<float>();
+        A_real_sparse_ = G_.cast<float>();
+        if ( !IsSparse() ) {
+            A_real_ = MatrixXd(G_).cast<float>();
+        }
+        if ( reduced_ ) {
+            ReduceMatrices();
+        } else {
+            A_reduced_.resize(0, 0);
+            z_reduced_.resize(0);
+        }
+        properties_ = AnalyzeMatrix(G_);
+        reduced_properties_ = reduced_ ? AnalyzeMatrix(G_reduced_) : properties_;
+    } else {
+        A_real_sparse_.resize(0, 0);
+        AssembleMatrices(omega_, A_sparse_, z_);
+        properties_ = AnalyzeMatrix(A_sparse_);
+        reduced_properties_ = properties_;
+        if ( !IsSparse() ) {
+            A_ = MatrixXcf(A_sparse_);
+        }
+    }
+}
+
+const MatrixXcf Circuit::GetAMatrix() const {
+    if ( real_ ) {
+        return IsSparse() ? MatrixXcf(MatrixXf(A_real_sparse_).cast<cd>()) : MatrixXcf(A_real_.cast<cd>());
+    }
+    return IsSparse() ? MatrixXcf(A_sparse_) : A_;
+}
+
+const SparseMatrix<cd> Circuit::GetSparseAMatrix() const {
+    return real_ ? SparseMatrix<cd>(A_real_sparse_.cast<cd>()) : A_sparse_;
+}
+
+void Circuit::BuildStampMatrices() {
+    /*
+    Walks the components once and stamps them into three real
+    matrices that do not depend on the frequency:
+
+        A(w) = G + jwC + Gamma / (jw)
+
+    G holds conductances and the +-1 entries of sources and DC
+    inductor rows, C capacitances and Gamma inverse inductances.
+    With DC indexing C also holds -L on the inductor rows, so that
+    G x + C dx/dt = s is the circuit's time domain equation.
+    Every stamp is pushed to all three matrices (zero where it does
+    not belong) so they share one sparsity pattern and can be
+    summed value by value. The source vector holds DC amplitudes.
+    The stamps are summed in double, so a large conductance does
+    not swallow a small one on the same diagonal before the
+    matrix is converted to the precision of the analysis.
+
+    Each type is stamped by its StampKernel. Components go through
+    one switch on their type, the element store is stamped after
+    them with a loop per type, so every element is a plain inlined
+    call.
+
+    The assembly plan records where each stamp entry landed in
+    the compressed value arrays, for UpdateValues.
+    */
+    s_ = VectorXd::Zero(dimension_);
+    s_elements_ = VectorXd::Zero(dimension_);
+    source_stamps_.clear();
+
+    StampContext context;
+    context.Reserve(4 * (components_.size() + elements_.Size()));
+    context.dc = omega_ == 0;
+    context.source_stamps = &source_stamps_;
+    StampValues(context);
+
+    G_.resize(dimension_, dimension_);
+    G_.setFromTriplets(context.g.begin(), context.g.end());
+    G_.makeCompressed();
+    C_.resize(dimension_, dimension_);
+    C_.setFromTriplets(context.c.begin(), context.c.end());
+    C_.makeCompressed();
+    Gamma_.resize(dimension_, dimension_);
+    Gamma_.setFromTriplets(context.gamma.begin(), context.gamma.end());
+    Gamma_.makeCompressed();
+
+    // offset of every entry in the value arrays, in stamp order
+    const int* outer = G_.outerIndexPtr();
+    const int* inner = G_.innerIndexPtr();
+    assembly_plan_.resize(context.g.size());
+    for ( size_t k = 0; k < context.g.size(); k++ ) {
+        const Triplet<double>& entry = context.g[k];
+        assembly_plan_[k] = std::lower_bound(inner + outer[entry.col()], inner + outer[entry.col() + 1], entry.row()) - inner;
+    }
+    plan_dc_ = context.dc;
+
+    // offset of every entry of G in the reduced matrix
+    if ( reduced_ ) {
+        std::vector<Triplet<double>> entries;
+        entries.reserve(G_.nonZeros());
+        for ( int col = 0; col < dimension_; col++ ) {
+            for ( int p = outer[col]; p < outer[col + 1]; p++ ) {
+                if ( reduced_index_[inner[p]] >= 0 && reduced_index_[col] >= 0 ) {
+                    entries.push_back(Triplet<double>(reduced_index_[inner[p]], reduced_index_[col], 0));
+                }
+            }
+        }
+        G_reduced_.resize(reduced_dimension_, reduced_dimension_);
+        G_reduced_.setFromTriplets(entries.begin(), entries.end());
+        G_reduced_.makeCompressed();
+        const int* reduced_outer = G_reduced_.outerIndexPtr();
+        const int* reduced_inner = G_reduced_.innerIndexPtr();
+        reduction_plan_.assign(G_.nonZeros(), -1);
+        for ( int col = 0; col < dimension_; col++ ) {
+            int c = reduced_index_[col];
+            for ( int p = outer[col]; p < outer[col + 1]; p++ ) {
+                int r = reduced_index_[inner[p]];
+                if ( r >= 0 && c >= 0 ) {
+                    reduction_plan_[p] = std::lower_bound(reduced_inner + reduced_outer[c],
+                        reduced_inner + reduced_outer[c + 1], r) - reduced_inner;
+                }
+            }
+        }
+    } else {
+        G_reduced_.resize(0, 0);
+        reduction_plan_.clear();
+    }
+}
+
+void Circuit::StampValues(StampContext& context) {
+    /*
+    Stamps the components and then the element store into
+    context, in the same order every time. The constant sources
+    of the element store go to s_elements_, the rest to s_.
+    Records where the entries of each component start.
+    */
+    context.s = &s_;
+    stamp_records_.assign(component_ids_, StampRecord());
     for ( auto const& component : components_ ) {
 
         std::shared_ptr<Node> out = component->GetTerminalNode(OUTPUT);
@@ -78,175 +847,235 @@ void Circuit::ConstructMatrices() {
 
         if (out == nullptr || in == nullptr) continue;  // other node is not connected
 
-        ComponentType type = component->GetType();
-        ComponentClass cls = component->GetClass();
-        std::string name = component->GetName();
-
-        std::string out_name = out->GetName();
-        std::string in_name = in->GetName();
-
-        std::complex<float> admittance = std::complex<float>(0.0, 0.0);
-
-        switch ( cls ) {
-            case PASSIVE:
-                /*
-                Construct G submatrix.
-                */
-                switch ( type ) {
-                    case RESISTOR:
-                        if (component->GetValue() > 0.0) {
-                            admittance = std::complex<float>(
-                                1 / component->GetValue(), 0
-                            );  // Y = 1 / Z = 1 / R
-                        }
-                        break;
-                    case CAPACITOR:
-                        if (omega != 0 && component->GetValue() > 0.0) {
-                            admittance = std::complex<float>(
-                                0, (component->GetValue() * omega)
-                            );  // Y = 1 / Z = j*w*C
-                        }
-                        break;
-                    case INDUCTOR:
-                        if (omega != 0 && component->GetValue() > 0.0) {
-                           admittance = std::complex<float>(
-                                0, (- 1 / (component->GetValue() * omega))
-                            );  // Y = 1 / Z = -j / (w*L) 
-                        }
-                        break;
-                    default:
-                        break;
-                }
-                if ( in->GetType() != GROUND && out->GetType() != GROUND ) {
-                    // component is between two nodes
-                    A_( node_indexes_[out_name], node_indexes_[in_name] ) += -admittance;
-                    A_( node_indexes_[in_name], node_indexes_[out_name] ) += -admittance;
-                }
-                if ( out->GetType() != GROUND ) {
-                    // output terminal is connected to some node
-                    A_( node_indexes_[out_name], node_indexes_[out_name] ) += admittance;
-                }
-                if ( in->GetType() != GROUND ) {
-                    // input terminal is connected to some node
-                    A_( node_indexes_[in_name], node_indexes_[in_name] ) += admittance;
-                }
+        StampRecord& record = stamp_records_[component->GetId()];
+        record.component = component.get();
+        record.start = context.Position();
+        record.value = component->GetValue();
 
-                if ( type == INDUCTOR && omega == 0) {
-                    int idx = inductor_indexes_[name];
-                    if ( out->GetType() != GROUND ) {
-                        A_( node_indexes_[out_name], idx ) = -1;
-                        A_( idx, node_indexes_[out_name]) = -1;
-                    }
-                    if ( in->GetType() != GROUND ) {
-                        A_( node_indexes_[in_name], idx ) = 1;
-                        A_( idx, node_indexes_[in_name]) = 1;
-                    }
-                }
+        context.source = component;
+        StampComponent(context, component->GetType(), out->GetIndex(), in->GetIndex(),
+            component->GetIndex(), component->GetValue());
+    }
+    context.source = nullptr;
 
-                break;
-            case ACTIVE:
-                /*
-                Construct B and C submatrices and z vector.
-                */
-                switch ( type ) {
-                    case VOLTAGE_SOURCE:
-                        if ( voltage_source_indexes_.find(name) == voltage_source_indexes_.end() ) {
-                            //if voltage source is not mapped map it for future reference
-                            voltage_source_indexes_[name] = n + l + voltage_sources_count;
-                            voltage_sources_count++;
-                        }
-                        if ( out->GetType() != GROUND ) {
-                            // output terminal is connected to some node
-                            A_(voltage_source_indexes_[name], node_indexes_[out_name]) = 1;  // append value to B submatrix
-                            A_(node_indexes_[out_name], voltage_source_indexes_[name]) = 1;  // append value to C submatrix
-                        }
-                        if ( in->GetType() != GROUND ) {
-                            // input terminal is connected to some node
-                            A_(voltage_source_indexes_[name], node_indexes_[in_name]) = -1;  // append value to B submatrix
-                            A_(node_indexes_[in_name], voltage_source_indexes_[name]) = -1;  // append value to C submatrix
-                        }
-                        if ( omega == 0 ) {
-                            z_(voltage_source_indexes_[name]) = component->GetValue();    
-                            break;
-                        } else {
-                            z_(voltage_source_indexes_[name]) = component->GetValue() * 0.70710678118;
-                            break;
-                        }
-                        break;
-                    case CURRENT_SOURCE:
-                        if ( omega == 0 ) {
-                            if ( out->GetType() != GROUND ) {
-                                z_(node_indexes_[out_name]) += component->GetValue();
-                            }
-                            if ( in->GetType() != GROUND ) {
-                                z_(node_indexes_[in_name]) += -component->GetValue();
-                            } 
-                        } else {
-                            if ( out->GetType() != GROUND ) {
-                                z_(node_indexes_[out_name]) += component->GetValue() * 0.70710678118;
-                            }
-                            if ( in->GetType() != GROUND ) {
-                                z_(node_indexes_[in_name]) += -component->GetValue() * 0.70710678118;
-                            } 
-                        }   
-                        break;
-                    default:
-                        break;
-                }
-                break;
+    // element store, one loop per type with the kernel inlined
+    context.s = &s_elements_;
+    const std::vector<int> none;
+    StampArrays<RESISTOR>(context, elements_.Get(RESISTOR), none, node_rows_);
+    StampArrays<CAPACITOR>(context, elements_.Get(CAPACITOR), none, node_rows_);
+    StampArrays<INDUCTOR>(context, elements_.Get(INDUCTOR), element_rows_[INDUCTOR], node_rows_);
+    StampArrays<VOLTAGE_SOURCE>(context, elements_.Get(VOLTAGE_SOURCE), element_rows_[VOLTAGE_SOURCE], node_rows_);
+    StampArrays<CURRENT_SOURCE>(context, elements_.Get(CURRENT_SOURCE), none, node_rows_);
+    s_ += s_elements_;
+
+    // everything is stamped with the current values
+    changes_->values.clear();
+    changes_->topology = false;
+    plan_revision_ = elements_.GetRevision();
+    plan_value_revision_ = elements_.GetValueRevision();
+}
+
+/*
+Writes the values of A(w) into the value array of A. Real
+scalars can only hold DC matrices, so C and Gamma are not
+read, complex ones add the susceptance jwC + Gamma / (jw).
+*/
+template <typename Real>
+static void AssignValues(
+        Map<Array<Real, Dynamic, 1>> a,
+        const Map<const ArrayXd>& g,
+        const Map<const ArrayXd>&,
+        const Map<const ArrayXd>&,
+        float omega
+    ) {
+    assert(omega == 0);
+    (void)omega;
+    a = g.cast<Real>();
+}
+
+template <typename Real>
+static void AssignValues(
+        Map<Array<std::complex<Real>, Dynamic, 1>> a,
+        const Map<const ArrayXd>& g,
+        const Map<const ArrayXd>& c,
+        const Map<const ArrayXd>& gamma,
+        float omega
+    ) {
+    a.real() = g.cast<Real>();
+    if ( omega != 0 ) {
+        a.imag() = (double(omega) * c - gamma / double(omega)).cast<Real>();
+    } else {
+        a.imag().setZero();
+    }
+}
+
+template <typename Scalar>
+void Circuit::AssembleMatrices(float omega, SparseMatrix<Scalar>& A, Matrix<typename NumTraits<Scalar>::Real, Dynamic, 1>& z) const {
+    /*
+    Forms A(w) = G + jwC + Gamma / (jw) and z from the stamp
+    matrices built by ConstructMatrices. This is a scaled sum
+    over the value arrays, O(nnz) with no branching per
+    component. A only allocates when it does not already have
+    the pattern of G. Does not modify the circuit, so several
+    threads can assemble it at different frequencies. Omega
+    must be nonzero exactly when ConstructMatrices was run with
+    a nonzero omega, since DC adds a row for every inductor.
+
+    The sum is formed in double and rounded to Scalar once, so
+    the precision of A is that of Scalar.
+    */
+    typedef typename NumTraits<Scalar>::Real Real;
+    const int nonzeros = G_.nonZeros();
+
+    bool same_pattern = A.rows() == dimension_ && A.cols() == dimension_
+        && A.isCompressed() && A.nonZeros() == nonzeros
+        && std::equal(G_.outerIndexPtr(), G_.outerIndexPtr() + dimension_ + 1, A.outerIndexPtr())
+        && std::equal(G_.innerIndexPtr(), G_.innerIndexPtr() + nonzeros, A.innerIndexPtr());
+    if ( !same_pattern ) {
+        A = G_.cast<Scalar>();
+    }
+
+    AssignValues(
+        Map<Array<Scalar, Dynamic, 1>>(A.valuePtr(), nonzeros),
+        Map<const ArrayXd>(G_.valuePtr(), nonzeros),
+        Map<const ArrayXd>(C_.valuePtr(), nonzeros),
+        Map<const ArrayXd>(Gamma_.valuePtr(), nonzeros),
+        omega
+    );
+
+    // sources are given as amplitudes, AC analysis uses rms values
+    if ( omega == 0 ) {
+        z = s_.cast<Real>();
+    } else {
+        z = (s_ * RMS_SCALE).cast<Real>();
+    }
+}
+
+template <typename Real>
+void Circuit::AssembleSources(float time, Matrix<Real, Dynamic, 1>& s) const {
+    /*
+    Source vector of the time domain equation at the given time,
+    sources with a waveform are evaluated at that time. Sources
+    in the element store are constant.
+    */
+    s = s_elements_.cast<Real>();
+    for ( auto const& stamp : source_stamps_ ) {
+        s(stamp.row) += stamp.sign * stamp.source->GetValueAt(time);
+    }
+}
+
+template void Circuit::AssembleMatrices<float>(float omega, SparseMatrix<float>& A, VectorXf& z) const;
+template void Circuit::AssembleMatrices<double>(float omega, SparseMatrix<double>& A, VectorXd& z) const;
+template void Circuit::AssembleMatrices<cd>(float omega, SparseMatrix<cd>& A, VectorXf& z) const;
+template void Circuit::AssembleMatrices<std::complex<double>>(float omega, SparseMatrix<std::complex<double>>& A, VectorXd& z) const;
+template void Circuit::AssembleSources<float>(float time, VectorXf& s) const;
+template void Circuit::AssembleSources<double>(float time, VectorXd& s) const;
+
+std::vector<float> Circuit::GetBreakpoints(float stop) const {
+    /*
+    Sorted breakpoints of every source waveform up to stop.
+    */
+    std::vector<float> breakpoints;
+    for ( auto const& component : components_ ) {
+        auto source = std::dynamic_pointer_cast<ActiveComponent>(component);
+        if ( source && source->GetWaveform() ) {
+            std::vector<float> b = source->GetWaveform()->GetBreakpoints(stop);
+            breakpoints.insert(breakpoints.end(), b.begin(), b.end());
         }
     }
+    std::sort(breakpoints.begin(), breakpoints.end());
+    breakpoints.erase(std::unique(breakpoints.begin(), breakpoints.end()), breakpoints.end());
+    return breakpoints;
 }
 
 const std::shared_ptr<Node> Circuit::AddNode(const std::string& node_name) {
     if (node_name == "-") return nullptr;
-    auto it = nodes_.find(node_name);
-    if (it == nodes_.end()) {
-        nodes_[node_name] = std::make_shared<Node>(node_name, node_name == "0" ? GROUND : NORMAL);
+    auto it = node_ids_.find(node_name);
+    if (it != node_ids_.end()) {
+        return nodes_[it->second];
     }
-    return nodes_[node_name];
+    int id = nodes_.size();
+    nodes_.push_back(std::make_shared<Node>(node_name, node_name == "0" ? GROUND : NORMAL, id));
+    nodes_.back()->SetChangeLog(changes_);
+    node_ids_[node_name] = id;
+    changes_->topology = true;
+    return nodes_.back();
 }
 
 const std::shared_ptr<Node> Circuit::AddNode() {
-    // completely new node
-    std::set<std::string> node_names;
-    for ( auto pair : nodes_ ) {
-        node_names.insert(pair.first);
+    // completely new node, N<k> with the first k not taken since the last one
+    std::string name = "N" + std::to_string(auto_name_);
+    while ( node_ids_.find(name) != node_ids_.end() ) {
+        name = "N" + std::to_string(++auto_name_);
     }
-    int j = 0;
-    while ( j < 99999 ) {
-        std::string s = "N" + std::to_string(j);
-        auto it = node_names.find(s);
-        if ( it == node_names.end() ) {
-            // not in nodes
-            auto n = std::make_shared<Node>(s);
-            nodes_[s] = n;
-            return n;
+    auto_name_++;
+    return AddNode(name);
+}
+
+bool Circuit::RemoveNode(const std::string& node_name) {
+    /*
+    A node a component is still connected to stays, since the
+    matrices are built from the terminals of the components.
+    */
+    auto it = node_ids_.find(node_name);
+    if ( it == node_ids_.end() || UsedNodes()[it->second] ) {
+        return false;
+    }
+    nodes_[it->second].reset();
+    node_ids_.erase(it);
+    changes_->topology = true;
+    return true;
+}
+
+std::map<std::string, std::shared_ptr<Node>> Circuit::GetNodes() const {
+    std::map<std::string, std::shared_ptr<Node>> nodes;
+    for ( auto const& node : nodes_ ) {
+        if ( node ) {
+            nodes[node->GetName()] = node;
         }
-        j++;
     }
-    return nullptr;
+    return nodes;
 }
 
-void Circuit::RemoveNode(const std::string& node_name) {
-    nodes_.erase(node_name);
+const std::shared_ptr<Node> Circuit::GetNode(int id) const {
+    return id >= 0 && id < int(nodes_.size()) ? nodes_[id] : nullptr;
+}
+
+ComponentHandle Circuit::AddElement(ComponentType type, const std::string& name, float value,
+        std::shared_ptr<Node> input, std::shared_ptr<Node> output) {
+    return elements_.Add(type, value, input ? input->GetId() : -1, output ? output->GetId() : -1, name);
 }
 
 void Circuit::AddComponent(std::shared_ptr<Component> component) {
+    component->SetId(component_ids_++);
+    component->SetChangeLog(changes_);
     components_.push_back(component);
+    changes_->topology = true;
 }
 
 bool Circuit::HasGround() {
-    for ( auto node : nodes_ ) {
-        if (node.second->GetType() == GROUND) {
+    for ( auto const& node : nodes_ ) {
+        if (node && node->GetType() == GROUND) {
             return true;
         }
     }
     return false;
 }
 
-bool Circuit::Solveable() const {
-    if (A_.rows() == 0 || A_.cols() == 0 || z_.cols() == 0 || z_.rows() == 0) {
+bool Circuit::IsSparse() const {
+    switch ( assembly_mode_ ) {
+        case DENSE_ASSEMBLY:
+            return false;
+        case SPARSE_ASSEMBLY:
+            return true;
+        default:
+            return dimension_ > SPARSE_ASSEMBLY_THRESHOLD;
+    }
+}
+
+bool Circuit::Solveable(bool transient) const {
+    const std::vector<std::string>& floating = transient ? transient_floating_nodes_ : floating_nodes_;
+    if (dimension_ == 0 || z_.cols() == 0 || z_.rows() == 0 || !floating.empty()) {
         return false;
     }
     return true;
@@ -0,0 +1,89 @@
+#include <string>
+
+#include "circuit_generator.hpp"
+#include "resistor.hpp"
+#include "current_source.hpp"
+#include "capacitor.hpp"
+#include "voltage_source.hpp"
+
+
+Circuit ResistorGrid(int n, float resistance, float load, float supply, float pad_resistance, bool elements) {
+    Circuit circuit = Circuit();
+    std::shared_ptr<Node> ground = circuit.AddNode("0");
+
+    auto name = [](int i, int j) { return std::to_string(i) + "_" + std::to_string(j); };
+
+    if ( elements ) {
+        ComponentStore& store = circuit.GetElements();
+        store.Reserve(RESISTOR, 2 * n * n);
+        store.Reserve(CURRENT_SOURCE, n * n + 4);
+    }
+    auto add = [&](ComponentType type, const std::string& element, float value,
+            std::shared_ptr<Node> input, std::shared_ptr<Node> output) {
+        if ( elements ) {
+            circuit.AddElement(type, "", value, input, output);
+        } else if ( type == RESISTOR ) {
+            circuit.AddComponent(std::make_shared<Resistor>(element, value, input, output));
+        } else {
+            circuit.AddComponent(std::make_shared<CurrentSource>(element, value, input, output));
+        }
+    };
+
+    for ( int i = 0; i < n; i++ ) {
+        for ( int j = 0; j < n; j++ ) {
+            std::shared_ptr<Node> node = circuit.AddNode("N" + name(i, j));
+            if ( i > 0 ) {
+                add(RESISTOR, "RV" + name(i, j), resistance, circuit.AddNode("N" + name(i - 1, j)), node);
+            }
+            if ( j > 0 ) {
+                add(RESISTOR, "RH" + name(i, j), resistance, circuit.AddNode("N" + name(i, j - 1)), node);
+            }
+            add(CURRENT_SOURCE, "IL" + name(i, j), load, node, ground);
+        }
+    }
+
+    int corners[][2] = { {0, 0}, {0, n - 1}, {n - 1, 0}, {n - 1, n - 1} };
+    for ( int k = 0; k < (n > 1 ? 4 : 1); k++ ) {
+        std::string pad = name(corners[k][0], corners[k][1]);
+        std::shared_ptr<Node> node = circuit.AddNode("N" + pad);
+        add(RESISTOR, "RP" + pad, pad_resistance, node, ground);
+        add(CURRENT_SOURCE, "IP" + pad, supply / pad_resistance, ground, node);
+    }
+    return circuit;
+}
+
+Circuit ResistorMesh(int nx, int ny, int nz, float resistance, float capacitance, float supply) {
+    Circuit circuit = Circuit();
+    std::shared_ptr<Node> ground = circuit.AddNode("0");
+
+    auto name = [](int i, int j, int k) {
+        return std::to_string(i) + "_" + std::to_string(j) + "_" + std::to_string(k);
+    };
+
+    for ( int i = 0; i < nx; i++ ) {
+        for ( int j = 0; j < ny; j++ ) {
+            for ( int k = 0; k < nz; k++ ) {
+                std::shared_ptr<Node> node = circuit.AddNode("N" + name(i, j, k));
+                if ( i > 0 ) {
+                    circuit.AddComponent(std::make_shared<Resistor>("RX" + name(i, j, k), resistance,
+                        circuit.AddNode("N" + name(i - 1, j, k)), node));
+                }
+                if ( j > 0 ) {
+                    circuit.AddComponent(std::make_shared<Resistor>("RY" + name(i, j, k), resistance,
+                        circuit.AddNode("N" + name(i, j - 1, k)), node));
+                }
+                if ( k > 0 ) {
+                    circuit.AddComponent(std::make_shared<Resistor>("RZ" + name(i, j, k), resistance,
+                        circuit.AddNode("N" + name(i, j, k - 1)), node));
+                }
+                if ( capacitance != 0 ) {
+                    circuit.AddComponent(std::make_shared<Capacitor>("C" + name(i, j, k), capacitance, node, ground));
+                }
+            }
+        }
+    }
+
+    circuit.AddComponent(std::make_shared<VoltageSource>("VS", supply, ground, circuit.AddNode("N" + name(0, 0, 0))));
+    circuit.AddComponent(std::make_shared<Resistor>("RL", resistance, circuit.AddNode("N" + name(nx - 1, ny - 1, nz - 1)), ground));
+    return circuit;
+}
@@ -8,6 +8,8 @@
 
 #include "circuit_simulator_gui.hpp"
 #include "MNAsolver.hpp"
+#include "ac_sweep.hpp"
+#include "transient_analysis.hpp"
 
 
 const float distance(sf::Vector2f &a, sf::Vector2f &b) {
@@ -747,7 +749,7 @@ void CircuitSimulatorGUI::RenderMenuBar() {
     /*
     Renders main window's menubar.
     */
-    bool open = false, save = false, ac = false;
+    bool open = false, save = false, ac = false, sweep = false, tran = false;
     if (ImGui::BeginMainMenuBar())
     {
         if (ImGui::BeginMenu("File"))
@@ -828,22 +830,18 @@ void CircuitSimulatorGUI::RenderMenuBar() {
                 if (circuit_.HasGround()) {
                     circuit_.ConstructMatrices();
                     if (circuit_.Solveable()) {
-                        auto solver = MNAsolver();
-                        solver.solveSteady(
-                            circuit_.GetAMatrix(),
-                            circuit_.GetZMatrix(),
-                            circuit_.GetOmega(),
-                            circuit_.GetNodeIndexes(),
-                            circuit_.GetVoltageSourceIndexes(),
-                            circuit_.GetInductorIndexes()
-                        );
-                        solver.setCurrents(
-                            circuit_.GetComponents(),
-                            circuit_.GetOmega()
-                        );
-                        solver.resultListed(std::cout);
+                        SolveSteady();
+                        if (solver_.IsSolved()) {
+                            solver_.setCurrents(
+                                circuit_.GetComponents(),
+                                circuit_.GetOmega()
+                            );
+                            solver_.resultListed(std::cout);
+                        } else {
+                            std::cout << "Failed to solve circuit." << std::endl;
+                        }
                     } else {
-                        std::cout << "Failed to solve circuit." << std::endl;
+                        ReportUnsolveable();
                     }
                 } else {
                     std::cout << "Add ground before simulating!" << std::endl;
@@ -852,6 +850,15 @@ void CircuitSimulatorGUI::RenderMenuBar() {
             if (ImGui::MenuItem("Steady state AC analysis")) {
                 ac = true;
             }
+            if (ImGui::MenuItem("AC sweep analysis")) {
+                sweep = true;
+            }
+            if (ImGui::MenuItem("Transient analysis")) {
+                tran = true;
+            }
+            ImGui::Separator();
+            ImGui::MenuItem("Double precision", NULL, &doublePrecision_);
+            ImGui::MenuItem("Mixed precision", NULL, &mixedPrecision_);
             ImGui::EndMenu();
         }
         ImGui::SameLine(ImGui::GetWindowWidth() - 150);
@@ -906,21 +913,83 @@ void CircuitSimulatorGUI::RenderMenuBar() {
             if (circuit_.HasGround()) {
                 circuit_.ConstructMatrices();
                 if (circuit_.Solveable()) {
-                    auto solver = MNAsolver();
-                    solver.solveSteady(
-                        circuit_.GetAMatrix(),
-                        circuit_.GetZMatrix(),
-                        circuit_.GetOmega(),
-                        circuit_.GetNodeIndexes(),
-                        circuit_.GetVoltageSourceIndexes(),
-                        circuit_.GetInductorIndexes()
-                    );
-                    solver.setCurrents(
-                        circuit_.GetComponents(),
-                        circuit_.GetOmega()
-                    );
-                    solver.resultListed(std::cout);
+                    SolveSteady();
+                    if (solver_.IsSolved()) {
+                        solver_.setCurrents(
+                            circuit_.GetComponents(),
+                            circuit_.GetOmega()
+                        );
+                        solver_.resultListed(std::cout);
+                    } else {
+                        std::cout << "Failed to solve circuit." << std::endl;
+                    }
+                } else {
+                    ReportUnsolveable();
+                }
+            } else {
+                std::cout << "Add ground before simulating!" << std::endl;
+            }
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel")) {
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::EndPopup();
+    }
+
+    if (sweep) ImGui::OpenPopup("Simulate AC sweep");
+
+    if (ImGui::BeginPopupModal("Simulate AC sweep")) {
+        static float start = 1.0f;
+        static float stop = 1000.0f;
+        static int points = 10;
+        static int spacing = DECADE_SWEEP;
+        ImGui::Text("Enter angluar frequency range [w]");
+        ImGui::InputFloat("Start", &start, 0.0f, 0.0f, "%.3f");
+        ImGui::InputFloat("Stop", &stop, 0.0f, 0.0f, "%.3f");
+        ImGui::InputInt("Points", &points);
+        ImGui::Combo("Spacing", &spacing, "Linear\0Decade\0Octave\0");
+        if (ImGui::Button("OK")) {
+            circuit_.RemoveUnnecessaryNodes();
+            if (circuit_.HasGround()) {
+                ACSweep ac_sweep = ACSweep(start, stop, points, SweepSpacing(spacing));
+                ac_sweep.SetMixedPrecision(mixedPrecision_);
+                if (ac_sweep.Run(circuit_)) {
+                    ac_sweep.resultListed(std::cout);
                 } else {
+                    ReportUnsolveable();
+                }
+            } else {
+                std::cout << "Add ground before simulating!" << std::endl;
+            }
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel")) {
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::EndPopup();
+    }
+
+    if (tran) ImGui::OpenPopup("Simulate transient");
+
+    if (ImGui::BeginPopupModal("Simulate transient")) {
+        static float step = 0.001f;
+        static float stop = 0.1f;
+        static int method = TRAPEZOIDAL;
+        static bool adaptive = false;
+        ImGui::Text("Enter time step and stop time [s]");
+        ImGui::InputFloat("Step", &step, 0.0f, 0.0f, "%.6f");
+        ImGui::InputFloat("Stop", &stop, 0.0f, 0.0f, "%.6f");
+        ImGui::Combo("Method", &method, "Backward Euler\0Trapezoidal\0");
+        ImGui::Checkbox("Adaptive step (step is the maximum)", &adaptive);
+        if (ImGui::Button("OK")) {
+            circuit_.RemoveUnnecessaryNodes();
+            if (circuit_.HasGround()) {
+                TransientAnalysis transient = TransientAnalysis(step, stop, IntegrationMethod(method));
+                transient.SetAdaptive(adaptive);
+                if (!transient.Run(circuit_, std::cout)) {
                     std::cout << "Failed to solve circuit." << std::endl;
                 }
             } else {
@@ -1020,4 +1089,60 @@ void CircuitSimulatorGUI::MainLoop() {
         ImGui::SFML::Render(*this);
         display();
     }
+}
+
+void CircuitSimulatorGUI::ReportUnsolveable() {
+    if (circuit_.GetFloatingNodes().empty()) {
+        std::cout << "Failed to solve circuit." << std::endl;
+        return;
+    }
+    std::cout << "Nodes without a path to ground:";
+    for (auto const& name : circuit_.GetFloatingNodes()) {
+        std::cout << " " << name;
+    }
+    std::cout << std::endl;
+}
+
+void CircuitSimulatorGUI::SolveSteady() {
+    /*
+    Solves the constructed circuit with the matrices it was
+    assembled into, real ones for DC and complex ones for AC.
+    In double and mixed precision the matrix is assembled again
+    from the stamps with double scalars, mixed precision then
+    factors it in single precision and refines the solution.
+    A solve after editing a few component values updates the
+    previous factorization instead of factoring again.
+    */
+    solver_.SetMatrixProperties(circuit_.GetMatrixProperties());
+    solver_.SetMixedPrecision(mixedPrecision_);
+    solver_.SetLowRankUpdates(LOW_RANK_MAX_RANK);  // value edits between solves
+    if (doublePrecision_ || mixedPrecision_) {
+        if (circuit_.IsReal()) {
+            SparseMatrix<double> A;
+            VectorXd z;
+            circuit_.AssembleMatrices(circuit_.GetOmega(), A, z);
+            solver_.solveSteady(
+                A,
+                z,
+                circuit_.GetOmega(),
+                circuit_.GetNodeIndexes(),
+                circuit_.GetVoltageSourceIndexes(),
+                circuit_.GetInductorIndexes()
+            );
+        } else {
+            SparseMatrix<std::complex<double>> A;
+            VectorXd z;
+            circuit_.AssembleMatrices(circuit_.GetOmega(), A, z);
+            solver_.solveSteady(
+                A,
+                z,
+                circuit_.GetOmega(),
+                circuit_.GetNodeIndexes(),
+                circuit_.GetVoltageSourceIndexes(),
+                circuit_.GetInductorIndexes()
+            );
+        }
+    } else {
+        solver_.solveSteady(circuit_);
+    }
 }
\ No newline at end of file
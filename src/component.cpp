@@ -31,6 +31,35 @@ void Component::ConnectNodeToTerminal(std::shared_ptr<Node> node, TerminalType t
             input_ = node;
             break;
     }
+    if ( changes_ ) {
+        changes_->topology = true;
+    }
+}
+
+int Component::GetId() const {
+    return id_;
+}
+
+void Component::SetId(int id) {
+    id_ = id;
+}
+
+int Component::GetIndex() const {
+    return index_;
+}
+
+void Component::SetIndex(int index) {
+    index_ = index;
+}
+
+void Component::SetChangeLog(std::shared_ptr<ChangeLog> changes) {
+    changes_ = changes;
+}
+
+void Component::ValueChanged() {
+    if ( changes_ ) {
+        changes_->values.push_back(id_);
+    }
 }
 
 std::ostream &operator<<(std::ostream &out, const Component& c) {
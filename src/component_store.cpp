@@ -0,0 +1,128 @@
+#include "component_store.hpp"
+
+
+ComponentHandle ComponentStore::Add(ComponentType type, float value, int input, int output, const std::string& name) {
+    int slot;
+    if ( free_slots_.empty() ) {
+        slot = slots_.size();
+        slots_.push_back(Slot());
+    } else {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+
+    Arrays& arrays = arrays_[type];
+    slots_[slot].type = type;
+    slots_[slot].position = arrays.values.size();
+    arrays.values.push_back(value);
+    arrays.outputs.push_back(output);
+    arrays.inputs.push_back(input);
+    arrays.slots.push_back(slot);
+
+    if ( !name.empty() ) {
+        names_[slot] = name;
+    }
+
+    revision_++;
+
+    ComponentHandle handle;
+    handle.slot = slot;
+    handle.generation = slots_[slot].generation;
+    return handle;
+}
+
+bool ComponentStore::Remove(ComponentHandle handle) {
+    if ( !Contains(handle) ) {
+        return false;
+    }
+    Slot& slot = slots_[handle.slot];
+    Arrays& arrays = arrays_[slot.type];
+
+    // move the last entry into the freed position
+    int position = slot.position;
+    int last = arrays.values.size() - 1;
+    if ( position != last ) {
+        arrays.values[position] = arrays.values[last];
+        arrays.outputs[position] = arrays.outputs[last];
+        arrays.inputs[position] = arrays.inputs[last];
+        arrays.slots[position] = arrays.slots[last];
+        slots_[arrays.slots[position]].position = position;
+    }
+    arrays.values.pop_back();
+    arrays.outputs.pop_back();
+    arrays.inputs.pop_back();
+    arrays.slots.pop_back();
+
+    names_.erase(handle.slot);
+    slot.position = -1;
+    slot.generation++;
+    free_slots_.push_back(handle.slot);
+    revision_++;
+    return true;
+}
+
+bool ComponentStore::Contains(ComponentHandle handle) const {
+    return handle.slot >= 0 && handle.slot < int(slots_.size())
+        && slots_[handle.slot].position >= 0
+        && slots_[handle.slot].generation == handle.generation;
+}
+
+void ComponentStore::Clear() {
+    for ( auto& arrays : arrays_ ) {
+        arrays = Arrays();
+    }
+    // the slots stay so that handles to the cleared components stay invalid
+    free_slots_.clear();
+    for ( int slot = slots_.size() - 1; slot >= 0; slot-- ) {
+        if ( slots_[slot].position >= 0 ) {
+            slots_[slot].position = -1;
+            slots_[slot].generation++;
+        }
+        free_slots_.push_back(slot);
+    }
+    names_.clear();
+    revision_++;
+}
+
+void ComponentStore::Reserve(ComponentType type, size_t count) {
+    Arrays& arrays = arrays_[type];
+    arrays.values.reserve(count);
+    arrays.outputs.reserve(count);
+    arrays.inputs.reserve(count);
+    arrays.slots.reserve(count);
+}
+
+float ComponentStore::GetValue(ComponentHandle handle) const {
+    const Slot& slot = slots_[handle.slot];
+    return arrays_[slot.type].values[slot.position];
+}
+
+void ComponentStore::SetValue(ComponentHandle handle, float value) {
+    const Slot& slot = slots_[handle.slot];
+    arrays_[slot.type].values[slot.position] = value;
+    value_revision_++;
+}
+
+int ComponentStore::GetNode(ComponentHandle handle, TerminalType terminal) const {
+    const Slot& slot = slots_[handle.slot];
+    const Arrays& arrays = arrays_[slot.type];
+    return terminal == OUTPUT ? arrays.outputs[slot.position] : arrays.inputs[slot.position];
+}
+
+const std::string ComponentStore::GetName(ComponentHandle handle) const {
+    auto it = names_.find(handle.slot);
+    return it != names_.end() ? it->second : "";
+}
+
+const std::string ComponentStore::GetName(ComponentType type, int position) const {
+    auto it = names_.find(arrays_[type].slots[position]);
+    return it != names_.end() ? it->second : "";
+}
+
+size_t ComponentStore::Size() const {
+    size_t size = 0;
+    for ( auto const& arrays : arrays_ ) {
+        size += arrays.values.size();
+    }
+    return size;
+}
@@ -13,6 +13,7 @@ float CurrentSource::GetValue() const {
 
 void CurrentSource::SetValue(float newval) {
     current_ = newval;
+    ValueChanged();
 }
 
 ComponentType CurrentSource::GetType() const {
@@ -14,6 +14,7 @@ float Inductor::GetValue() const {
 
 void Inductor::SetValue(float newval) {
     inductance_ = newval;
+    ValueChanged();
 }
 
 std::complex<float> Inductor::GetAdmittance(const float w) const {
@@ -1,8 +1,9 @@
 #include "node.hpp"
+#include "component.hpp"
 
 
-Node::Node(const std::string &name, NodeType type)
-    : name_(name), type_(type) { }
+Node::Node(const std::string &name, NodeType type, int id)
+    : name_(name), type_(type), id_(id) { }
 
 const std::string& Node::GetName() const {
     return name_;
@@ -13,9 +14,28 @@ const NodeType Node::GetType() const {
 }
 
 void Node::SetNodeType(NodeType type) {
+    if ( changes_ && type != type_ ) {
+        changes_->topology = true;
+    }
     type_ = type;
 }
 
+int Node::GetId() const {
+    return id_;
+}
+
+int Node::GetIndex() const {
+    return index_;
+}
+
+void Node::SetIndex(int index) {
+    index_ = index;
+}
+
+void Node::SetChangeLog(std::shared_ptr<ChangeLog> changes) {
+    changes_ = changes;
+}
+
 std::ostream &operator<<(std::ostream& out, const Node& node) {
     out << "\n" << node.GetName();
     if (node.GetType() == GROUND) {
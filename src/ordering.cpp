@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <complex>
+#include <limits>
+#include <vector>
+
+#include "ordering.hpp"
+#include "Eigen/OrderingMethods"
+
+typedef PermutationMatrix<Dynamic, Dynamic, int> Permutation;
+
+
+const std::string OrderingName(OrderingType ordering) {
+    switch ( ordering ) {
+        case AUTO_ORDERING:
+            return "Auto";
+        case NATURAL_ORDERING:
+            return "Natural";
+        case AMD_ORDERING:
+            return "AMD";
+        case COLAMD_ORDERING:
+            return "COLAMD";
+        case RCM_ORDERING:
+            return "RCM";
+        default:
+            return "Unknown";
+    }
+}
+
+template <typename Scalar>
+static SparseMatrix<int> SymmetricPattern(const SparseMatrix<Scalar>& A) {
+    // pattern of A + A^T with a full diagonal, values are ignored
+    std::vector<Triplet<int>> triplets;
+    triplets.reserve(2 * A.nonZeros() + A.rows());
+    for ( int k = 0; k < A.outerSize(); ++k ) {
+        for ( typename SparseMatrix<Scalar>::InnerIterator it(A, k); it; ++it ) {
+            triplets.push_back(Triplet<int>(it.row(), it.col(), 1));
+            triplets.push_back(Triplet<int>(it.col(), it.row(), 1));
+        }
+    }
+    for ( int i = 0; i < A.rows(); i++ ) {
+        triplets.push_back(Triplet<int>(i, i, 1));
+    }
+    SparseMatrix<int> S(A.rows(), A.cols());
+    S.setFromTriplets(triplets.begin(), triplets.end());
+    return S;
+}
+
+static std::vector<int> ReverseCuthillMcKee(const SparseMatrix<int>& S) {
+    /*
+    Breadth first search from a pseudo-peripheral node of each
+    connected component, visiting neighbours in order of
+    increasing degree, reversed. Keeps the nonzeros in a narrow
+    band around the diagonal, so the fill stays inside it.
+    Returns the unknowns in elimination order.
+    */
+    const int n = S.rows();
+    const int* outer = S.outerIndexPtr();
+    const int* inner = S.innerIndexPtr();
+
+    std::vector<int> degree(n);
+    for ( int i = 0; i < n; i++ ) {
+        degree[i] = outer[i + 1] - outer[i];
+    }
+
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<bool> visited(n, false);
+    std::vector<int> mark(n, -1);
+    std::vector<int> distance(n, 0);
+    std::vector<int> queue;
+    int stamp = 0;
+
+    // eccentricity of root, farthest is a node of least degree on the last level
+    auto levels = [&](int root, int& farthest) {
+        stamp++;
+        queue.assign(1, root);
+        mark[root] = stamp;
+        distance[root] = 0;
+        for ( size_t head = 0; head < queue.size(); head++ ) {
+            int i = queue[head];
+            for ( int p = outer[i]; p < outer[i + 1]; p++ ) {
+                int j = inner[p];
+                if ( mark[j] != stamp ) {
+                    mark[j] = stamp;
+                    distance[j] = distance[i] + 1;
+                    queue.push_back(j);
+                }
+            }
+        }
+        int eccentricity = distance[queue.back()];
+        farthest = queue.back();
+        for ( int i : queue ) {
+            if ( distance[i] == eccentricity && degree[i] < degree[farthest] ) {
+                farthest = i;
+            }
+        }
+        return eccentricity;
+    };
+
+    for ( int start = 0; start < n; start++ ) {
+        if ( visited[start] ) continue;
+
+        int root = start;
+        int farthest;
+        int eccentricity = levels(root, farthest);
+        while ( true ) {
+            int next;
+            int e = levels(farthest, next);
+            if ( e <= eccentricity ) break;
+            root = farthest;
+            eccentricity = e;
+            farthest = next;
+        }
+
+        size_t head = order.size();
+        order.push_back(root);
+        visited[root] = true;
+        for ( ; head < order.size(); head++ ) {
+            int i = order[head];
+            size_t first = order.size();
+            for ( int p = outer[i]; p < outer[i + 1]; p++ ) {
+                int j = inner[p];
+                if ( !visited[j] ) {
+                    visited[j] = true;
+                    order.push_back(j);
+                }
+            }
+            std::sort(order.begin() + first, order.end(),
+                [&degree](int a, int b) { return degree[a] < degree[b]; });
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+static Permutation PatternOrdering(const SparseMatrix<int>& S, OrderingType ordering) {
+    const int n = S.rows();
+    Permutation P(n);
+
+    switch ( ordering ) {
+        case AMD_ORDERING: {
+            // Eigen's AMD returns the elimination order, the inverse of P
+            Permutation order;
+            AMDOrdering<int>()(S, order);
+            P = order.inverse();
+            break;
+        }
+        case COLAMD_ORDERING:
+            COLAMDOrdering<int>()(S, P);
+            break;
+        case RCM_ORDERING: {
+            std::vector<int> order = ReverseCuthillMcKee(S);
+            for ( int k = 0; k < n; k++ ) {
+                P.indices()[order[k]] = k;
+            }
+            break;
+        }
+        default:
+            P.setIdentity();
+    }
+    return P;
+}
+
+template <typename Scalar>
+PermutationMatrix<Dynamic, Dynamic, int> ComputeOrdering(const SparseMatrix<Scalar>& A, OrderingType ordering) {
+    return PatternOrdering(SymmetricPattern(A), ordering);
+}
+
+static void Bisect(const SparseMatrix<int>& S, std::vector<int>& nodes, int first, int parts,
+        std::vector<int>& part, std::vector<int>& level) {
+    /*
+    Splits nodes, all in part first, between parts first ..
+    first + parts - 1. A breadth first search from a pseudo-
+    peripheral node orders them in levels, every edge joins the
+    same or adjacent levels, so the nodes of one level separate
+    the levels before it from those after. The level is picked
+    where the nodes before it reach the share of the first half
+    of the parts, and only its nodes with a neighbour further on
+    are kept as the separator. Nodes the search does not reach
+    are not connected to the rest and go to the second half.
+    */
+    if ( parts <= 1 || nodes.size() < 2 ) {
+        return;
+    }
+    const int* outer = S.outerIndexPtr();
+    const int* inner = S.innerIndexPtr();
+    const int unreached = std::numeric_limits<int>::max();
+
+    std::vector<int> queue;
+    auto search = [&](int root) {
+        for ( int i : nodes ) {
+            level[i] = unreached;
+        }
+        queue.assign(1, root);
+        level[root] = 0;
+        for ( size_t head = 0; head < queue.size(); head++ ) {
+            int i = queue[head];
+            for ( int p = outer[i]; p < outer[i + 1]; p++ ) {
+                int j = inner[p];
+                if ( part[j] == first && level[j] == unreached ) {
+                    level[j] = level[i] + 1;
+                    queue.push_back(j);
+                }
+            }
+        }
+        return level[queue.back()];
+    };
+
+    int root = nodes.front();
+    int eccentricity = search(root);
+    for ( int pass = 0; pass < 4; pass++ ) {
+        int farthest = queue.back();
+        int e = search(farthest);
+        if ( e <= eccentricity ) {
+            break;
+        }
+        root = farthest;
+        eccentricity = e;
+    }
+    search(root);
+
+    const int left_parts = (parts + 1) / 2;
+    size_t target = size_t(double(nodes.size()) * left_parts / parts);
+    int split = level[queue[std::min(target, queue.size() - 1)]];
+
+    std::vector<int> left;
+    std::vector<int> right;
+    for ( int i : nodes ) {
+        if ( level[i] < split ) {
+            left.push_back(i);
+        } else if ( level[i] > split ) {
+            right.push_back(i);
+        }
+    }
+    for ( int i : nodes ) {
+        if ( level[i] != split ) continue;
+        bool boundary = false;
+        for ( int p = outer[i]; p < outer[i + 1] && !boundary; p++ ) {
+            int j = inner[p];
+            boundary = part[j] == first && level[j] > split;
+        }
+        if ( boundary ) {
+            part[i] = -1;
+        } else {
+            left.push_back(i);
+        }
+    }
+    for ( int i : right ) {
+        part[i] = first + left_parts;
+    }
+    nodes.clear();
+    nodes.shrink_to_fit();
+
+    Bisect(S, left, first, left_parts, part, level);
+    Bisect(S, right, first + left_parts, parts - left_parts, part, level);
+}
+
+template <typename Scalar>
+std::vector<int> PartitionGraph(const SparseMatrix<Scalar>& A, int parts) {
+    const int n = A.rows();
+    std::vector<int> part(n, 0);
+    std::vector<int> level(n, 0);
+    std::vector<int> nodes(n);
+    for ( int i = 0; i < n; i++ ) {
+        nodes[i] = i;
+    }
+    Bisect(SymmetricPattern(A), nodes, 0, std::max(1, parts), part, level);
+    return part;
+}
+
+template <typename Scalar>
+FillStatistics AnalyzeFill(const SparseMatrix<Scalar>& A, OrderingType ordering) {
+    /*
+    Counts the nonzeros of each column of L with the elimination
+    tree (Liu's algorithm, as in LDL symbolic): the pattern of
+    row k of L is the set of nodes reached walking up the tree
+    from every nonzero A(i, k), i < k. U has the transposed
+    pattern of L. Eliminating column k costs a division per
+    nonzero below the diagonal and a multiply-add per entry of
+    the c_k x c_k update.
+    */
+    FillStatistics statistics;
+    statistics.ordering = ordering == AUTO_ORDERING ? NATURAL_ORDERING : ordering;
+    statistics.dimension = A.rows();
+    statistics.nonzeros = A.nonZeros();
+
+    const int n = A.rows();
+    if ( n == 0 || A.rows() != A.cols() ) {
+        return statistics;
+    }
+
+    SparseMatrix<int> S = SymmetricPattern(A);
+    Permutation P = PatternOrdering(S, statistics.ordering);
+    SparseMatrix<int> B = P * S * P.transpose();
+
+    std::vector<int> parent(n, -1);
+    std::vector<int> flag(n, -1);
+    std::vector<long> counts(n, 0);
+    for ( int k = 0; k < n; k++ ) {
+        flag[k] = k;
+        for ( SparseMatrix<int>::InnerIterator it(B, k); it; ++it ) {
+            int i = it.row();
+            for ( ; i < k && flag[i] != k; i = parent[i] ) {
+                if ( parent[i] == -1 ) {
+                    parent[i] = k;
+                }
+                counts[i]++;
+                flag[i] = k;
+            }
+        }
+    }
+
+    long lower = 0;
+    double flops = 0;
+    for ( int k = 0; k < n; k++ ) {
+        lower += counts[k];
+        flops += counts[k] + 2.0 * counts[k] * counts[k];
+    }
+
+    statistics.factor_nonzeros = 2 * lower + n;
+    statistics.fill_ratio = statistics.nonzeros > 0 ? double(statistics.factor_nonzeros) / statistics.nonzeros : 0;
+    statistics.flops = flops;
+    return statistics;
+}
+
+template <typename Scalar>
+void CompareOrderings(const SparseMatrix<Scalar>& A, std::ostream& out) {
+    OrderingType orderings[] = { NATURAL_ORDERING, AMD_ORDERING, COLAMD_ORDERING, RCM_ORDERING };
+    for ( auto ordering : orderings ) {
+        out << AnalyzeFill(A, ordering) << std::endl;
+    }
+}
+
+std::ostream &operator<<(std::ostream& out, const FillStatistics& statistics) {
+    std::streamsize precision = out.precision(3);
+    out << "Ordering: " << OrderingName(statistics.ordering)
+        << ", nnz(A) " << statistics.nonzeros
+        << ", nnz(L+U) " << statistics.factor_nonzeros
+        << ", fill ratio " << statistics.fill_ratio
+        << ", flops " << statistics.flops;
+    out.precision(precision);
+    return out;
+}
+
+#define INSTANTIATE_ORDERING(Scalar) \
+    template PermutationMatrix<Dynamic, Dynamic, int> ComputeOrdering<Scalar>(const SparseMatrix<Scalar>& A, OrderingType ordering); \
+    template std::vector<int> PartitionGraph<Scalar>(const SparseMatrix<Scalar>& A, int parts); \
+    template FillStatistics AnalyzeFill<Scalar>(const SparseMatrix<Scalar>& A, OrderingType ordering); \
+    template void CompareOrderings<Scalar>(const SparseMatrix<Scalar>& A, std::ostream& out);
+
+INSTANTIATE_ORDERING(float)
+INSTANTIATE_ORDERING(double)
+INSTANTIATE_ORDERING(std::complex<float>)
+INSTANTIATE_ORDERING(std::complex<double>)
@@ -14,6 +14,7 @@ float Resistor::GetValue() const {
 
 void Resistor::SetValue(float newval) {
     resistance_ = newval;
+    ValueChanged();
 }
 
 float Resistor::GetAdmittance() const {
@@ -0,0 +1,138 @@
+#include "simulation_results.hpp"
+
+
+template <typename Scalar>
+void ResultStore<Scalar>::SetIndexes(
+        const std::map<std::string, int>& node_indexes,
+        const std::map<std::string, int>& voltage_source_indexes,
+        const std::map<std::string, int>& inductor_indexes,
+        int rows
+    ) {
+    rows_ = rows;
+    names_.assign(rows, "");
+    types_.assign(rows, NODE_VOLTAGE);
+    indexes_.clear();
+    indexes_.reserve(node_indexes.size() + voltage_source_indexes.size() + inductor_indexes.size());
+    node_rows_.clear();
+    component_ids_.clear();
+    components_ = 0;
+
+    auto add = [this](const std::map<std::string, int>& indexes, ResultType type) {
+        for ( auto const& pair : indexes ) {
+            if ( pair.second < 0 || pair.second >= rows_ ) {
+                continue;
+            }
+            names_[pair.second] = pair.first;
+            types_[pair.second] = type;
+            indexes_.insert(pair);  // keeps a node of the same name
+        }
+    };
+    add(node_indexes, NODE_VOLTAGE);
+    add(voltage_source_indexes, VOLTAGE_SOURCE_CURRENT);
+    add(inductor_indexes, INDUCTOR_CURRENT);
+    Clear();
+}
+
+template <typename Scalar>
+void ResultStore<Scalar>::SetIndexes(const Circuit& circuit) {
+    SetIndexes(circuit.GetNodeIndexes(), circuit.GetVoltageSourceIndexes(), circuit.GetInductorIndexes(),
+        circuit.GetDimension());
+    node_rows_ = circuit.GetNodeRows();
+    components_ = circuit.GetComponentIdCount();
+    for ( auto const& component : circuit.GetComponents() ) {
+        component_ids_[component->GetName()] = component->GetId();
+    }
+}
+
+template <typename Scalar>
+void ResultStore<Scalar>::SetComponentCount(int count) {
+    components_ = count;
+    currents_.assign(points_.size() * size_t(components_), Scalar(0));
+}
+
+template <typename Scalar>
+void ResultStore<Scalar>::Clear() {
+    values_.clear();
+    currents_.clear();
+    points_.clear();
+}
+
+template <typename Scalar>
+void ResultStore<Scalar>::Reserve(int columns) {
+    values_.reserve(size_t(columns) * rows_);
+    currents_.reserve(size_t(columns) * components_);
+    points_.reserve(columns);
+}
+
+template <typename Scalar>
+void ResultStore<Scalar>::Resize(const std::vector<float>& points) {
+    points_ = points;
+    values_.assign(points.size() * size_t(rows_), Scalar(0));
+    currents_.assign(points.size() * size_t(components_), Scalar(0));
+}
+
+template <typename Scalar>
+bool ResultStore<Scalar>::AddColumn(float point, const VectorType& x) {
+    if ( x.rows() != rows_ ) {
+        return false;
+    }
+    points_.push_back(point);
+    values_.insert(values_.end(), x.data(), x.data() + rows_);
+    currents_.resize(currents_.size() + components_, Scalar(0));
+    return true;
+}
+
+template <typename Scalar>
+int ResultStore<Scalar>::GetIndex(const std::string& name) const {
+    auto found = indexes_.find(name);
+    return found == indexes_.end() ? -1 : found->second;
+}
+
+template <typename Scalar>
+int ResultStore<Scalar>::GetNodeIndex(int node_id) const {
+    if ( node_id < 0 || node_id >= int(node_rows_.size()) ) {
+        return -1;
+    }
+    return node_rows_[node_id] < rows_ ? node_rows_[node_id] : -1;
+}
+
+template <typename Scalar>
+int ResultStore<Scalar>::GetComponentId(const std::string& name) const {
+    auto found = component_ids_.find(name);
+    return found == component_ids_.end() ? -1 : found->second;
+}
+
+template <typename Scalar>
+Scalar ResultStore<Scalar>::GetVoltage(int node_id, int column) const {
+    int index = GetNodeIndex(node_id);
+    return index < 0 ? Scalar(0) : Get(index, column);
+}
+
+template <typename Scalar>
+std::ostream& ResultStore<Scalar>::resultListed(std::ostream &out) const {
+    /*
+    One line per column, the point first and then every named
+    row in index order.
+    */
+    out << "point";
+    for ( int i = 0; i < rows_; i++ ) {
+        if ( !names_[i].empty() ) {
+            out << " " << names_[i] << (types_[i] == NODE_VOLTAGE ? "[V]" : "[A]");
+        }
+    }
+    out << "\n";
+
+    for ( int k = 0; k < GetColumns(); k++ ) {
+        out << points_[k];
+        for ( int i = 0; i < rows_; i++ ) {
+            if ( !names_[i].empty() ) {
+                out << " " << Get(i, k);
+            }
+        }
+        out << "\n";
+    }
+    return out.flush();
+}
+
+template class ResultStore<cd>;
+template class ResultStore<float>;
@@ -0,0 +1,259 @@
+#include "solver_backend.hpp"
+#include "iterative_backend.hpp"
+#include "domain_decomposition.hpp"
+#include "circuit.hpp"
+
+
+template <typename Scalar>
+MatrixProperties AnalyzeMatrix(const SparseMatrix<Scalar>& A) {
+    /*
+    Detects size, density and symmetry of A. MNA stamps of
+    passive elements and independent sources are symmetric,
+    and the matrix is real for DC analysis. A hermitian matrix
+    with a positive diagonal has no source or inductor rows
+    (those have a zero diagonal), so it is a nodal matrix that
+    can be factored with LDLT.
+    */
+    MatrixProperties properties;
+    properties.dimension = A.rows();
+    properties.nonzeros = A.nonZeros();
+    properties.fingerprint = PatternFingerprint(A);
+
+    if ( A.rows() == 0 || A.rows() != A.cols() ) {
+        return properties;
+    }
+
+    properties.density = float(A.nonZeros()) / (float(A.rows()) * float(A.cols()));
+
+    SparseMatrix<Scalar> At = A.transpose();
+    properties.symmetric = (A - At).norm() <= 1e-6 * A.norm();
+
+    bool real = true;
+    bool positive_diagonal = true;
+    for ( int k = 0; k < A.outerSize(); ++k ) {
+        bool has_diagonal = false;
+        for ( typename SparseMatrix<Scalar>::InnerIterator it(A, k); it; ++it ) {
+            if ( std::imag(it.value()) != 0 ) {
+                real = false;
+            }
+            if ( it.row() == it.col() ) {
+                has_diagonal = true;
+                if ( std::real(it.value()) <= 0 ) {
+                    positive_diagonal = false;
+                }
+            }
+        }
+        if ( !has_diagonal ) {
+            positive_diagonal = false;
+        }
+    }
+
+    properties.hermitian = properties.symmetric && real;
+    properties.definite = properties.hermitian && positive_diagonal;
+
+    return properties;
+}
+
+template <typename Scalar>
+std::uint64_t PatternFingerprint(const SparseMatrix<Scalar>& A) {
+    /*
+    FNV-1a hash of the dimensions and the compressed index
+    arrays of A. Matrices with equal fingerprints share the
+    sparsity pattern, so a symbolic factorization of one is
+    valid for the other. Values do not affect the hash.
+    */
+    std::uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](std::uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    };
+
+    mix(A.rows());
+    mix(A.cols());
+    for ( int k = 0; k < A.outerSize(); ++k ) {
+        mix(k);
+        for ( typename SparseMatrix<Scalar>::InnerIterator it(A, k); it; ++it ) {
+            mix(it.index());
+        }
+    }
+    return hash;
+}
+
+SolverBackendType SelectBackend(const MatrixProperties& properties) {
+    /*
+    The "auto" policy. Small or nearly full matrices are faster
+    to factor densely, everything else goes to the sparse
+    factorizations. Nodal matrices use LDLT, which needs half
+    the work of LU, the rest fall back to partial pivoting LU.
+    The iterative and Schur complement backends are never
+    picked here.
+    */
+    bool dense = properties.dimension <= SPARSE_ASSEMBLY_THRESHOLD
+        || properties.density > DENSE_BACKEND_DENSITY;
+
+    if ( dense ) {
+        return properties.definite ? DENSE_LDLT : PARTIAL_PIV_LU;
+    }
+    return properties.definite ? SPARSE_LDLT : SPARSE_LU;
+}
+
+const std::string BackendName(SolverBackendType type) {
+    switch ( type ) {
+        case AUTO_BACKEND:
+            return "Auto";
+        case PARTIAL_PIV_LU:
+            return "PartialPivLU";
+        case FULL_PIV_LU:
+            return "FullPivLU";
+        case DENSE_LDLT:
+            return "LDLT";
+        case SPARSE_LU:
+            return "SparseLU";
+        case SPARSE_LDLT:
+            return "SimplicialLDLT";
+        case CONJUGATE_GRADIENT:
+            return "ConjugateGradient";
+        case BICGSTAB_ILU0:
+            return "BiCGSTAB+ILU0";
+        case BICGSTAB_ILUT:
+            return "BiCGSTAB+ILUT";
+        case GMRES_ILU0:
+            return "GMRES+ILU0";
+        case GMRES_ILUT:
+            return "GMRES+ILUT";
+        case MULTIGRID:
+            return "Multigrid";
+        case CONJUGATE_GRADIENT_AMG:
+            return "ConjugateGradient+AMG";
+        case SCHUR_COMPLEMENT:
+            return "SchurComplement";
+        default:
+            return "Unknown";
+    }
+}
+
+OrderingType DefaultOrdering(SolverBackendType type) {
+    switch ( type ) {
+        case SPARSE_LU:
+            return COLAMD_ORDERING;
+        case SPARSE_LDLT:
+        case SCHUR_COMPLEMENT:
+            return AMD_ORDERING;
+        default:
+            return NATURAL_ORDERING;
+    }
+}
+
+template <typename Scalar>
+std::unique_ptr<SolverBackend<Scalar>> CreateBackend(SolverBackendType type, OrderingType ordering) {
+    if ( ordering != AUTO_ORDERING && type == SPARSE_LU ) {
+        std::unique_ptr<SolverBackend<Scalar>> natural(
+            new SparseBackend<SparseLU<SparseMatrix<Scalar>, NaturalOrdering<int>>, SPARSE_LU>());
+        return std::unique_ptr<SolverBackend<Scalar>>(new ReorderedBackend<Scalar>(std::move(natural), ordering));
+    }
+    if ( ordering != AUTO_ORDERING && type == SPARSE_LDLT ) {
+        std::unique_ptr<SolverBackend<Scalar>> natural(
+            new SparseBackend<SimplicialLDLT<SparseMatrix<Scalar>, Lower, NaturalOrdering<int>>, SPARSE_LDLT>());
+        return std::unique_ptr<SolverBackend<Scalar>>(new ReorderedBackend<Scalar>(std::move(natural), ordering));
+    }
+
+    switch ( type ) {
+        case FULL_PIV_LU:
+            return std::unique_ptr<SolverBackend<Scalar>>(new FullPivLUBackend<Scalar>());
+        case DENSE_LDLT:
+            return std::unique_ptr<SolverBackend<Scalar>>(new DenseLDLTBackend<Scalar>());
+        case SPARSE_LU:
+            return std::unique_ptr<SolverBackend<Scalar>>(new SparseLUBackend<Scalar>());
+        case SPARSE_LDLT:
+            return std::unique_ptr<SolverBackend<Scalar>>(new SparseLDLTBackend<Scalar>());
+        case CONJUGATE_GRADIENT:
+            return std::unique_ptr<SolverBackend<Scalar>>(new ConjugateGradientBackend<Scalar>());
+        case BICGSTAB_ILU0:
+            return std::unique_ptr<SolverBackend<Scalar>>(new BiCGSTABILU0Backend<Scalar>());
+        case BICGSTAB_ILUT:
+            return std::unique_ptr<SolverBackend<Scalar>>(new BiCGSTABILUTBackend<Scalar>());
+        case GMRES_ILU0:
+            return std::unique_ptr<SolverBackend<Scalar>>(new GMRESILU0Backend<Scalar>());
+        case GMRES_ILUT:
+            return std::unique_ptr<SolverBackend<Scalar>>(new GMRESILUTBackend<Scalar>());
+        case MULTIGRID:
+            return std::unique_ptr<SolverBackend<Scalar>>(new MultigridBackend<Scalar>());
+        case CONJUGATE_GRADIENT_AMG:
+            return std::unique_ptr<SolverBackend<Scalar>>(new ConjugateGradientAMGBackend<Scalar>());
+        case SCHUR_COMPLEMENT:
+            return std::unique_ptr<SolverBackend<Scalar>>(new SchurComplementBackend<Scalar>(0, 0,
+                ordering == AUTO_ORDERING ? DefaultOrdering(SCHUR_COMPLEMENT) : ordering));
+        case PARTIAL_PIV_LU:
+        default:
+            return std::unique_ptr<SolverBackend<Scalar>>(new PartialPivLUBackend<Scalar>());
+    }
+}
+
+template <typename Scalar>
+RefinementResult SolveRefined(
+        const SolverBackend<typename SinglePrecision<Scalar>::type>& backend,
+        const SparseMatrix<Scalar>& A,
+        const Matrix<Scalar, Dynamic, 1>& b,
+        Matrix<Scalar, Dynamic, 1>& x,
+        double tolerance,
+        int max_steps
+    ) {
+    /*
+    Mixed precision solve. The backend holds a single precision
+    factorization of A, which gives x to about float accuracy.
+    The residual r = b - A x is then formed in the precision of
+    A and the correction solved from it with the same factors,
+
+        x += LU \ r
+
+    which converges to the accuracy of Scalar as long as A is
+    not too ill-conditioned for the single precision factors
+    (condition number well below 1e7). Stops at the tolerance,
+    after max_steps corrections, or when the residual stops
+    decreasing, keeping the best x.
+    */
+    typedef typename SinglePrecision<Scalar>::type Single;
+    typedef Matrix<Scalar, Dynamic, 1> Vector;
+
+    RefinementResult result;
+    double scale = b.norm() > 0 ? b.norm() : 1;
+
+    x = backend.Solve(b.template cast<Single>()).template cast<Scalar>();
+    Vector r = b - A * x;
+    result.residual = r.norm() / scale;
+
+    while ( result.residual > tolerance && result.steps < max_steps ) {
+        Vector correction = backend.Solve(r.template cast<Single>()).template cast<Scalar>();
+        Vector r_next = b - A * (x + correction);
+        double residual = r_next.norm() / scale;
+        if ( !(residual < result.residual) ) {
+            break;  // stagnated, the factors are too inaccurate for A
+        }
+        x += correction;
+        r.swap(r_next);
+        result.residual = residual;
+        result.steps++;
+    }
+
+    result.converged = result.residual <= tolerance;
+    return result;
+}
+
+// real matrices for DC analysis, complex ones for AC, each in single and double precision
+#define INSTANTIATE_BACKENDS(Scalar) \
+    template MatrixProperties AnalyzeMatrix<Scalar>(const SparseMatrix<Scalar>& A); \
+    template std::uint64_t PatternFingerprint<Scalar>(const SparseMatrix<Scalar>& A); \
+    template std::unique_ptr<SolverBackend<Scalar>> CreateBackend<Scalar>(SolverBackendType type, OrderingType ordering); \
+    template RefinementResult SolveRefined<Scalar>( \
+        const SolverBackend<SinglePrecision<Scalar>::type>& backend, \
+        const SparseMatrix<Scalar>& A, \
+        const Matrix<Scalar, Dynamic, 1>& b, \
+        Matrix<Scalar, Dynamic, 1>& x, \
+        double tolerance, \
+        int max_steps \
+    );
+
+INSTANTIATE_BACKENDS(float)
+INSTANTIATE_BACKENDS(double)
+INSTANTIATE_BACKENDS(cd)
+INSTANTIATE_BACKENDS(std::complex<double>)
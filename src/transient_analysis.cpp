@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "transient_analysis.hpp"
+
+
+TransientAnalysis::TransientAnalysis(float step, float stop, IntegrationMethod method)
+    : step_(step), stop_(stop), method_(method) { }
+
+
+struct StepMatrix {
+    float h;
+    SparseMatrix<float> Ck;  // k*C/h, conductances of the companion models
+    SparseLU<SparseMatrix<float>, COLAMDOrdering<int>> lu;
+};
+
+static std::unique_ptr<StepMatrix> FactorStep(
+        const SparseMatrix<float>& G,
+        const SparseMatrix<float>& C,
+        float k,
+        float h
+    ) {
+    std::unique_ptr<StepMatrix> step(new StepMatrix());
+    step->h = h;
+    step->Ck = C * (k / h);
+    SparseMatrix<float> M = G + step->Ck;
+    M.makeCompressed();
+    step->lu.compute(M);
+    if ( step->lu.info() != Success ) {
+        return nullptr;
+    }
+    return step;
+}
+
+bool TransientAnalysis::Run(Circuit& circuit, Output output) {
+    steps_ = 0;
+    solves_ = 0;
+    rejected_ = 0;
+    factorizations_ = 0;
+
+    if ( step_ <= 0 || stop_ < 0 ) {
+        return false;
+    }
+
+    circuit.SetOmega(0.0);
+    circuit.ConstructMatrices();
+    // nodes reached only through capacitors are fine unless the DC operating point is solved
+    if ( !circuit.Solveable(!use_operating_point_) ) {
+        return false;
+    }
+
+    node_indexes_ = circuit.GetNodeIndexes();
+    voltage_source_indexes_ = circuit.GetVoltageSourceIndexes();
+    inductor_indexes_ = circuit.GetInductorIndexes();
+
+    branches_.clear();
+    for ( auto const& component : circuit.GetComponents() ) {
+        ComponentType type = component->GetType();
+        std::shared_ptr<Node> out = component->GetTerminalNode(OUTPUT);
+        std::shared_ptr<Node> in = component->GetTerminalNode(INPUT);
+        if ( !out || !in || (type != RESISTOR && type != CAPACITOR && type != INDUCTOR) ) continue;
+        branches_.push_back({ component->GetId(), type, out->GetIndex(), in->GetIndex(),
+            component->GetIndex(), component->GetValue() });
+    }
+    capacitor_currents_ = VectorXf::Zero(branches_.size());
+
+    const SparseMatrix<float> G = circuit.GetGMatrix().cast<float>();
+    const SparseMatrix<float> C = circuit.GetCMatrix().cast<float>();
+    const int dimension = G.rows();
+
+    const float k = method_ == TRAPEZOIDAL ? 2 : 1;
+    const int order = method_ == TRAPEZOIDAL ? 2 : 1;
+    /*
+    Local truncation error from the predictor - corrector difference
+    (Milne's device). With a corrector error of C h^(p+1) x^(p+1)
+    and a predictor error of C* h^(p+1) x^(p+1) the difference is
+    (C - C*) h^(p+1) x^(p+1), so the corrector error is the
+    difference times C / (C - C*). At equal steps:
+
+        trapezoidal       C = -1/12, quadratic predictor C* = 1: 1/13
+        backward Euler    C = -1/2,  linear predictor    C* = 1: 1/3
+    */
+    const float error_constant = method_ == TRAPEZOIDAL ? 1.0 / 13 : 1.0 / 3;
+
+    VectorXf s(dimension);
+    VectorXf x = VectorXf::Zero(dimension);
+    VectorXf y = VectorXf::Zero(dimension);  // C dx/dt of the previous step
+
+    if ( use_operating_point_ ) {
+        // at the operating point every capacitor is open and inductor shorted
+        std::unique_ptr<SolverBackend<float>> dc = CreateBackend<float>(SelectBackend(circuit.GetMatrixProperties()));
+        if ( !dc->Compute(G) ) {
+            return false;
+        }
+        circuit.AssembleSources(0, s);
+        x = dc->Solve(s);
+    }
+
+    // the truncation error is only checked on the state variables
+    VectorXf state = C.diagonal();
+
+    std::vector<float> breakpoints;
+    if ( adaptive_ ) {
+        breakpoints = circuit.GetBreakpoints(stop_);
+    }
+    breakpoints.push_back(stop_);
+    size_t next_breakpoint = 0;
+
+    const int initial_level = adaptive_ ? int(std::ceil(std::log(1e3) / std::log(ratio_))) : 0;
+    const int max_level = adaptive_ ? int(std::ceil(std::log(1e9) / std::log(ratio_))) : 0;
+    const int count = int(std::round(stop_ / step_));
+    int level = initial_level;
+    std::map<int, std::unique_ptr<StepMatrix>> levels;
+
+    double t = 0;
+    bool restart = true;  // first step after t = 0 or a breakpoint
+    int history = 0;  // accepted points since the last restart
+    double t_prev[2] = {0, 0};  // times of the previous points, newest first
+    VectorXf x_prev[2];
+
+    VectorXf rhs(dimension);
+    VectorXf x_half(dimension);
+    VectorXf x_next(dimension);
+    VectorXf y_next(dimension);
+
+    output(0, x);
+
+    while ( adaptive_ ? t < stop_ * (1 - 1e-6) : steps_ < count ) {
+        double h = step_ / std::pow(ratio_, level);
+        bool at_breakpoint = false;
+
+        std::unique_ptr<StepMatrix> truncated;
+        StepMatrix* step = nullptr;
+
+        if ( adaptive_ ) {
+            while ( next_breakpoint + 1 < breakpoints.size()
+                    && breakpoints[next_breakpoint] <= t + 1e-6 * h ) {
+                next_breakpoint++;
+            }
+            double breakpoint = breakpoints[next_breakpoint];
+            if ( t + h >= breakpoint - 1e-3 * h ) {
+                // cut the step short to land on the breakpoint
+                h = breakpoint - t;
+                at_breakpoint = true;
+
+                // reuse a cached factorization when h happens to be one of the levels
+                int exact = int(std::round(std::log(step_ / h) / std::log(ratio_)));
+                auto found = levels.find(exact);
+                if ( found != levels.end() && std::abs(found->second->h - h) <= 1e-5 * h ) {
+                    step = found->second.get();
+                } else {
+                    truncated = FactorStep(G, C, k, h);
+                    step = truncated.get();
+                    factorizations_++;
+                }
+            }
+        }
+        if ( !at_breakpoint ) {
+            std::unique_ptr<StepMatrix>& cached = levels[level];
+            if ( !cached ) {
+                cached = FactorStep(G, C, k, h);
+                factorizations_++;
+            }
+            step = cached.get();
+        }
+        if ( !step ) {
+            return false;
+        }
+
+        circuit.AssembleSources(t + h, s);
+
+        if ( restart && method_ == TRAPEZOIDAL ) {
+            // two backward Euler steps of h / 2 with the same matrix
+            circuit.AssembleSources(t + h / 2, rhs);
+            rhs += step->Ck * x;
+            x_half = step->lu.solve(rhs);
+            rhs = s + step->Ck * x_half;
+            x_next = step->lu.solve(rhs);
+            y_next = step->Ck * (x_next - x_half);
+            solves_ += 2;
+        } else {
+            rhs = s + step->Ck * x;
+            if ( method_ == TRAPEZOIDAL ) {
+                rhs += y;
+            }
+            x_next = step->lu.solve(rhs);
+            // current of the reactive elements for the next step's history source
+            y_next = step->Ck * (x_next - x) - (k - 1) * y;
+            solves_ += 1;
+        }
+        if ( !x_next.allFinite() ) {
+            return false;
+        }
+
+        if ( adaptive_ && !restart && history >= order ) {
+            /*
+            Predict x at t + h by extrapolating the last order + 1
+            points and compare with the solution.
+            */
+            double t_next = t + h;
+            VectorXf predicted;
+            if ( order == 1 ) {
+                double a = (t_next - t_prev[0]) / (t - t_prev[0]);
+                predicted = a * x + (1 - a) * x_prev[0];
+            } else {
+                double t0 = t_prev[1], t1 = t_prev[0], t2 = t;
+                double l0 = (t_next - t1) * (t_next - t2) / ((t0 - t1) * (t0 - t2));
+                double l1 = (t_next - t0) * (t_next - t2) / ((t1 - t0) * (t1 - t2));
+                double l2 = (t_next - t0) * (t_next - t1) / ((t2 - t0) * (t2 - t1));
+                predicted = l0 * x_prev[1] + l1 * x_prev[0] + l2 * x;
+            }
+
+            float error = 0;
+            for ( int i = 0; i < dimension; i++ ) {
+                if ( state(i) == 0 ) continue;
+                float scale = abstol_ + reltol_ * std::max(std::abs(x_next(i)), std::abs(x(i)));
+                error = std::max(error, error_constant * std::abs(x_next(i) - predicted(i)) / scale);
+            }
+
+            // step size factor that would give an error of 0.8 tolerances
+            float factor = error > 0 ? 0.9 * std::pow(error, -1.0 / (order + 1)) : ratio_;
+
+            if ( error > 1 && level < max_level ) {
+                int shrink = std::max(1, int(std::ceil(-std::log(factor) / std::log(ratio_))));
+                level = std::min(max_level, level + shrink);
+                rejected_++;
+                continue;
+            }
+            if ( factor >= ratio_ && !at_breakpoint && level > 0 ) {
+                level--;
+            }
+        }
+
+        // accept the step
+
+        // companion model current of every capacitor, y_next one component at a time
+        const bool split = restart && method_ == TRAPEZOIDAL;
+        const VectorXf& base = split ? x_half : x;
+        const float conductance = split ? 2 / h : k / h;
+        const float carry = split ? 0 : k - 1;
+        for ( size_t j = 0; j < branches_.size(); j++ ) {
+            const Branch& branch = branches_[j];
+            if ( branch.type != CAPACITOR ) continue;
+            float dv = (branch.in >= 0 ? x_next(branch.in) - base(branch.in) : 0)
+                - (branch.out >= 0 ? x_next(branch.out) - base(branch.out) : 0);
+            capacitor_currents_(j) = branch.value * conductance * dv - carry * capacitor_currents_(j);
+        }
+
+        t_prev[1] = t_prev[0];
+        x_prev[1].swap(x_prev[0]);
+        t_prev[0] = t;
+        x_prev[0] = x;
+        history++;
+
+        x.swap(x_next);
+        y.swap(y_next);
+        t += h;
+
+        steps_++;
+        output(float(t), x);
+
+        restart = at_breakpoint;
+        if ( at_breakpoint ) {
+            // the source derivatives jump, restart with small steps
+            history = 0;
+            level = std::max(level, initial_level);
+        }
+    }
+    return true;
+}
+
+bool TransientAnalysis::Run(Circuit& circuit, std::ostream& out) {
+    bool header = false;
+
+    return Run(circuit, [&](float time, const VectorXf& x) {
+        if ( !header ) {
+            out << "t";
+            for ( auto const& pair : node_indexes_ ) {
+                out << " " << pair.first << "[V]";
+            }
+            for ( auto const& pair : voltage_source_indexes_ ) {
+                out << " " << pair.first << "[A]";
+            }
+            for ( auto const& pair : inductor_indexes_ ) {
+                out << " " << pair.first << "[A]";
+            }
+            out << "\n";
+            header = true;
+        }
+
+        out << time;
+        for ( auto const& pair : node_indexes_ ) {
+            out << " " << x(pair.second);
+        }
+        for ( auto const& pair : voltage_source_indexes_ ) {
+            out << " " << x(pair.second);
+        }
+        for ( auto const& pair : inductor_indexes_ ) {
+            out << " " << x(pair.second);
+        }
+        out << "\n";
+    });
+}
+
+bool TransientAnalysis::Run(Circuit& circuit, TransientResults& results) {
+    /*
+    The store is indexed at the first step, once the circuit has
+    been constructed. Columns are appended, so adaptive steps
+    need no count up front.
+    */
+    results = TransientResults();
+
+    return Run(circuit, [&](float time, const VectorXf& x) {
+        if ( results.GetRows() != x.rows() ) {
+            results.SetIndexes(circuit);
+        }
+        results.AddColumn(time, x);
+        PassiveCurrents(x, results.Currents(results.GetColumns() - 1));
+    });
+}
+
+void TransientAnalysis::PassiveCurrents(const VectorXf& x, Ref<VectorXf> currents) const {
+    /*
+    I = (V_in - V_out) / R for resistors. Inductor currents are
+    unknowns of the solution and capacitor currents are those of
+    their companion models at the last accepted step.
+    */
+    currents.setZero();
+    for ( size_t j = 0; j < branches_.size(); j++ ) {
+        const Branch& branch = branches_[j];
+        if ( branch.id < 0 || branch.id >= currents.size() ) continue;
+        switch ( branch.type ) {
+            case RESISTOR:
+                if ( branch.value > 0 ) {
+                    currents(branch.id) = ((branch.in >= 0 ? x(branch.in) : 0) - (branch.out >= 0 ? x(branch.out) : 0)) / branch.value;
+                }
+                break;
+            case CAPACITOR:
+                currents(branch.id) = capacitor_currents_(j);
+                break;
+            case INDUCTOR:
+                if ( branch.row >= 0 ) {
+                    currents(branch.id) = x(branch.row);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
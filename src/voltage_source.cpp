@@ -13,6 +13,7 @@ float VoltageSource::GetValue() const {
 
 void VoltageSource::SetValue(float newval) {
     voltage_ = newval;
+    ValueChanged();
 }
 
 ComponentType VoltageSource::GetType() const {
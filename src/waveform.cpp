@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cmath>
+
+#include "waveform.hpp"
+
+
+PulseWaveform::PulseWaveform(float v1, float v2, float delay, float rise, float fall, float width, float period)
+    : v1_(v1), v2_(v2), delay_(delay), rise_(rise), fall_(fall), width_(width), period_(period) { }
+
+
+float PulseWaveform::GetValue(float time) const {
+    if ( time < delay_ ) {
+        return v1_;
+    }
+    float t = time - delay_;
+    if ( period_ > 0 ) {
+        t = std::fmod(t, period_);
+    }
+    if ( t < rise_ ) {
+        return v1_ + (v2_ - v1_) * t / rise_;
+    }
+    t -= rise_;
+    if ( t <= width_ ) {
+        return v2_;
+    }
+    t -= width_;
+    if ( t < fall_ ) {
+        return v2_ + (v1_ - v2_) * t / fall_;
+    }
+    return v1_;
+}
+
+std::vector<float> PulseWaveform::GetBreakpoints(float stop) const {
+    std::vector<float> breakpoints;
+    float start = delay_;
+    do {
+        float corners[] = { start, start + rise_, start + rise_ + width_, start + rise_ + width_ + fall_ };
+        for ( float corner : corners ) {
+            if ( corner > 0 && corner <= stop ) {
+                breakpoints.push_back(corner);
+            }
+        }
+        start += period_;
+    } while ( period_ > 0 && start <= stop );
+
+    std::sort(breakpoints.begin(), breakpoints.end());
+    breakpoints.erase(std::unique(breakpoints.begin(), breakpoints.end()), breakpoints.end());
+    return breakpoints;
+}
+
+
+SineWaveform::SineWaveform(float offset, float amplitude, float frequency, float delay, float damping)
+    : offset_(offset), amplitude_(amplitude), frequency_(frequency), delay_(delay), damping_(damping) { }
+
+
+float SineWaveform::GetValue(float time) const {
+    if ( time < delay_ ) {
+        return offset_;
+    }
+    float t = time - delay_;
+    return offset_ + amplitude_ * std::exp(-damping_ * t) * std::sin(2 * float(M_PI) * frequency_ * t);
+}
+
+std::vector<float> SineWaveform::GetBreakpoints(float stop) const {
+    std::vector<float> breakpoints;
+    if ( delay_ > 0 && delay_ <= stop ) {
+        breakpoints.push_back(delay_);
+    }
+    return breakpoints;
+}
+
+
+PWLWaveform::PWLWaveform(const std::vector<std::pair<float, float>>& points)
+    : points_(points) { }
+
+
+float PWLWaveform::GetValue(float time) const {
+    if ( points_.empty() ) {
+        return 0;
+    }
+    if ( time <= points_.front().first ) {
+        return points_.front().second;
+    }
+    for ( size_t i = 1; i < points_.size(); i++ ) {
+        if ( time <= points_[i].first ) {
+            const std::pair<float, float>& a = points_[i - 1];
+            const std::pair<float, float>& b = points_[i];
+            if ( b.first == a.first ) {
+                return b.second;
+            }
+            return a.second + (b.second - a.second) * (time - a.first) / (b.first - a.first);
+        }
+    }
+    return points_.back().second;
+}
+
+std::vector<float> PWLWaveform::GetBreakpoints(float stop) const {
+    std::vector<float> breakpoints;
+    for ( auto const& point : points_ ) {
+        if ( point.first > 0 && point.first <= stop ) {
+            breakpoints.push_back(point.first);
+        }
+    }
+    return breakpoints;
+}
@@ -2,6 +2,7 @@
 #include <complex>
 #include <iostream> 
 #include <map>
+#include <sstream>
 
 #include "doctest.h"
 #include "MNAsolver.hpp"
@@ -13,6 +14,9 @@
 #include "voltage_source.hpp"
 #include "current_source.hpp"
 #include "node.hpp"
+#include "circuit_generator.hpp"
+#include "multigrid.hpp"
+#include "domain_decomposition.hpp"
 #include "Eigen/Dense"
 
 typedef std::complex<float> cd;
@@ -299,3 +303,1177 @@ SCENARIO("MNA solver calculates correctly") {
     }
 }
 
+
+SCENARIO("Sparse and dense assembly give the same solution") {
+    GIVEN("Circuit with reactive elements assembled in both modes") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+        std::shared_ptr<Node> n3 = c.AddNode("N3");
+
+        c.AddComponent(std::make_shared<Resistor>("R1", 100, n1, n2));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.005, n2, n3));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.00002, n3, g));
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 12, g, n1));
+        c.SetOmega( 314.159265359 );
+
+        c.SetAssemblyMode(DENSE_ASSEMBLY);
+        c.ConstructMatrices();
+        MatrixXcf A = c.GetAMatrix();
+
+        c.SetAssemblyMode(SPARSE_ASSEMBLY);
+        c.ConstructMatrices();
+
+        WHEN("solved with the sparse solver") {
+            MNAsolver solver = MNAsolver();
+
+            solver.solveSteady(c.GetSparseAMatrix(), c.GetZMatrix(), c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            Eigen::VectorXcf Refx = MatrixXcf::Zero(4, 1);
+            Refx << cd(8.48528,0), cd(6.04926,-3.83876), cd(6.10956,-3.87703), cd(-0.0243602,-0.0383876);
+
+            THEN("sparse matrix equals the dense one") {
+                CHECK(c.IsSparse());
+                CHECK(MatrixXcf(c.GetSparseAMatrix()).isApprox(A));
+            }
+
+            THEN("solution matches the reference") {
+                CHECK(solver.IsSolved());
+                CHECK(solver.GetxVector().isApprox(Refx));
+            }
+        }
+    }
+}
+
+SCENARIO("Solver backends") {
+    GIVEN("Resistor network driven by current sources") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+
+        c.AddComponent(std::make_shared<CurrentSource>("J1", 2, g, n1));
+        c.AddComponent(std::make_shared<Resistor>("R1", 2, n1, n2));
+        c.AddComponent(std::make_shared<Resistor>("R2", 4, n2, g));
+        c.AddComponent(std::make_shared<Resistor>("R3", 4, n2, g));
+
+        c.ConstructMatrices();
+
+        Eigen::VectorXcf Refx = MatrixXcf::Zero(2, 1);
+        Refx << cd(8,0), cd(4,0);
+
+        THEN("nodal matrix is detected as symmetric definite") {
+            MatrixProperties p = c.GetMatrixProperties();
+            CHECK(p.dimension == 2);
+            CHECK(p.symmetric);
+            CHECK(p.hermitian);
+            CHECK(p.definite);
+        }
+
+        WHEN("solved with the auto policy") {
+            MNAsolver solver = MNAsolver();
+            solver.SetMatrixProperties(c.GetMatrixProperties());
+            solver.solveSteady(c.GetAMatrix(), c.GetZMatrix(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("LDLT is picked") {
+                CHECK(solver.GetUsedBackend() == DENSE_LDLT);
+                CHECK(solver.GetBackendName() == "LDLT");
+                CHECK(solver.GetxVector().isApprox(Refx));
+            }
+        }
+
+        WHEN("solved with every backend") {
+            SolverBackendType types[] = { PARTIAL_PIV_LU, FULL_PIV_LU, DENSE_LDLT, SPARSE_LU, SPARSE_LDLT };
+
+            THEN("all give the same result") {
+                for ( auto type : types ) {
+                    MNAsolver solver = MNAsolver();
+                    solver.SetBackend(type);
+                    solver.solveSteady(c.GetSparseAMatrix(), c.GetZMatrix(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+                    CHECK(solver.GetUsedBackend() == type);
+                    CHECK(solver.GetxVector().isApprox(Refx));
+                }
+            }
+        }
+    }
+
+    GIVEN("Circuit with a voltage source") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 5, g, n1));
+        c.AddComponent(std::make_shared<Resistor>("R1", 5, n1, g));
+
+        c.ConstructMatrices();
+
+        WHEN("solved with the auto policy") {
+            MNAsolver solver = MNAsolver();
+            solver.solveSteady(c.GetAMatrix(), c.GetZMatrix(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("indefinite matrix is solved with LU") {
+                CHECK_FALSE(c.GetMatrixProperties().definite);
+                CHECK(solver.GetUsedBackend() == PARTIAL_PIV_LU);
+                CHECK(solver.GetNodeVoltages().at("N1") == cd(5,0));
+            }
+        }
+    }
+}
+
+SCENARIO("Symbolic factorization is reused for the same topology") {
+    GIVEN("Sparse RLC circuit solved once") {
+
+        Circuit c = Circuit();
+        c.SetAssemblyMode(SPARSE_ASSEMBLY);
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+        std::shared_ptr<Node> n3 = c.AddNode("N3");
+
+        std::shared_ptr<Resistor> r1 = std::make_shared<Resistor>("R1", 100, n1, n2);
+        c.AddComponent(r1);
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.005, n2, n3));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.00002, n3, g));
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 12, g, n1));
+        c.SetOmega( 100 );
+        c.ConstructMatrices();
+
+        MNAsolver solver = MNAsolver();
+        solver.solveSteady(c.GetSparseAMatrix(), c.GetZMatrix(), c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+        CHECK_FALSE(solver.ReusedAnalysis());
+
+        std::uint64_t fingerprint = c.GetTopologyFingerprint();
+
+        WHEN("omega and a component value change") {
+            c.SetOmega( 314.159265359 );
+            r1->SetValue(100);
+            c.ConstructMatrices();
+            solver.solveSteady(c.GetSparseAMatrix(), c.GetZMatrix(), c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            Eigen::VectorXcf Refx = MatrixXcf::Zero(4, 1);
+            Refx << cd(8.48528,0), cd(6.04926,-3.83876), cd(6.10956,-3.87703), cd(-0.0243602,-0.0383876);
+
+            THEN("only the numeric factorization is redone") {
+                CHECK(c.GetTopologyFingerprint() == fingerprint);
+                CHECK(solver.ReusedAnalysis());
+                CHECK(solver.GetxVector().isApprox(Refx));
+            }
+        }
+
+        WHEN("a component is added") {
+            c.AddComponent(std::make_shared<Resistor>("R2", 50, n1, n3));
+            c.ConstructMatrices();
+            solver.solveSteady(c.GetSparseAMatrix(), c.GetZMatrix(), c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("the cached analysis is invalidated") {
+                CHECK(c.GetTopologyFingerprint() != fingerprint);
+                CHECK_FALSE(solver.ReusedAnalysis());
+                CHECK(solver.IsSolved());
+            }
+        }
+    }
+}
+
+SCENARIO("DC circuits are solved with real arithmetic") {
+    GIVEN("DC circuit with a voltage source and an inductor") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+        std::shared_ptr<Node> n3 = c.AddNode("N3");
+
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 12, g, n1));
+        c.AddComponent(std::make_shared<Resistor>("R1", 100, n1, n2));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.005, n2, n3));
+        c.AddComponent(std::make_shared<Resistor>("R2", 200, n3, g));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.00002, n3, g));
+        c.ConstructMatrices();
+
+        MNAsolver reference = MNAsolver();
+        reference.solveSteady(c.GetAMatrix(), c.GetZMatrix(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+        THEN("the circuit is assembled as a real matrix") {
+            CHECK(c.IsReal());
+            CHECK(c.GetRealAMatrix().cast<cd>().isApprox(c.GetAMatrix()));
+            CHECK(MatrixXcf(c.GetSparseAMatrix()).isApprox(c.GetAMatrix()));
+        }
+
+        WHEN("solved with the dense and sparse real solvers") {
+            MNAsolver dense = MNAsolver();
+            dense.solveSteady(c.GetRealAMatrix(), c.GetZMatrix(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            MNAsolver sparse = MNAsolver();
+            sparse.solveSteady(c.GetRealSparseAMatrix(), c.GetZMatrix(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("results match the complex solve") {
+                CHECK(dense.IsReal());
+                CHECK(sparse.IsReal());
+                CHECK_FALSE(reference.IsReal());
+                CHECK(dense.GetxVector().isApprox(reference.GetxVector()));
+                CHECK(sparse.GetxVector().isApprox(reference.GetxVector()));
+                CHECK(sparse.GetNodeVoltages().at("N3").real() == doctest::Approx(8));
+                CHECK(sparse.GetNodeVoltages().at("N3").imag() == 0);
+            }
+
+            THEN("resistor currents are V / R") {
+                sparse.setCurrents(c.GetComponents(), 0);
+                reference.setCurrents(c.GetComponents(), 0);
+
+                std::ostringstream real_out, complex_out;
+                sparse.resultListed(real_out);
+                reference.resultListed(complex_out);
+                CHECK(real_out.str() == complex_out.str());
+            }
+        }
+
+        WHEN("the same circuit is constructed for AC") {
+            c.SetOmega( 314.159265359 );
+            c.ConstructMatrices();
+
+            THEN("it is assembled as a complex matrix") {
+                CHECK_FALSE(c.IsReal());
+                CHECK(c.GetSparseAMatrix().rows() == 4);
+            }
+        }
+    }
+}
+
+SCENARIO("Circuits are solved in single or double precision") {
+    GIVEN("Small resistor in series with a large one") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 1, g, n1));
+        c.AddComponent(std::make_shared<Resistor>("R1", 0.001, n1, n2));
+        c.AddComponent(std::make_shared<Resistor>("R2", 1000000, n2, g));
+        c.ConstructMatrices();
+
+        WHEN("solved in double precision") {
+            SparseMatrix<double> A;
+            VectorXd z;
+            c.AssembleMatrices(c.GetOmega(), A, z);
+
+            MNAsolver solver = MNAsolver();
+            solver.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("the voltage drop over the small resistor is resolved") {
+                CHECK(solver.IsSolved());
+                CHECK(solver.IsReal());
+                VectorXcd x = solver.GetxVectorDouble();
+                double drop = (x(c.GetNodeIndexes().at("N1")) - x(c.GetNodeIndexes().at("N2"))).real();
+                CHECK(drop == doctest::Approx(1e-9).epsilon(1e-6));
+            }
+        }
+
+        WHEN("solved in single precision") {
+            MNAsolver solver = MNAsolver();
+            solver.solveSteady(c.GetRealSparseAMatrix(), c.GetZMatrix(), c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("the drop is below float resolution but the current is not") {
+                CHECK(solver.IsSolved());
+                CHECK(solver.GetNodeVoltages().at("N2").real() == doctest::Approx(1));
+                CHECK(solver.GetVoltageSourceCurrents().at("S1").real() == doctest::Approx(-1e-6));
+            }
+        }
+    }
+
+    GIVEN("AC circuit assembled with every scalar type") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+        std::shared_ptr<Node> n3 = c.AddNode("N3");
+
+        c.AddComponent(std::make_shared<Resistor>("R1", 100, n1, n2));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.005, n2, n3));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.00002, n3, g));
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 12, g, n1));
+        c.SetOmega( 314.159265359 );
+        c.ConstructMatrices();
+
+        SparseMatrix<std::complex<double>> A;
+        VectorXd z;
+        c.AssembleMatrices(c.GetOmega(), A, z);
+
+        MNAsolver single = MNAsolver();
+        single.solveSteady(c.GetSparseAMatrix(), c.GetZMatrix(), c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+        MNAsolver precise = MNAsolver();
+        precise.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+        THEN("both precisions agree") {
+            CHECK(MatrixXcd(A).cast<cd>().isApprox(c.GetAMatrix()));
+            CHECK_FALSE(precise.IsReal());
+            CHECK(precise.GetxVector().isApprox(single.GetxVector()));
+        }
+    }
+}
+
+SCENARIO("Mixed precision solve with iterative refinement") {
+    GIVEN("Small resistor in series with a large one") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+        std::shared_ptr<Node> n3 = c.AddNode("N3");
+
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 1, g, n1));
+        c.AddComponent(std::make_shared<Resistor>("R1", 0.001, n1, n2));
+        c.AddComponent(std::make_shared<Resistor>("R2", 1000, n2, n3));
+        c.AddComponent(std::make_shared<Resistor>("R3", 3000, n3, g));
+        c.ConstructMatrices();
+
+        SparseMatrix<double> A;
+        VectorXd z;
+        c.AssembleMatrices(c.GetOmega(), A, z);
+
+        MNAsolver reference = MNAsolver();
+        reference.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+        WHEN("factored in single precision and refined") {
+            MNAsolver solver = MNAsolver();
+            solver.SetMixedPrecision(true);
+            solver.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("the solution has double accuracy") {
+                CHECK(solver.IsSolved());
+                CHECK(solver.IsRefined());
+                CHECK_FALSE(reference.IsRefined());
+                CHECK(solver.GetRefinementSteps() > 0);
+                CHECK(solver.GetResidual() <= REFINEMENT_TOLERANCE);
+                CHECK(solver.GetxVectorDouble().isApprox(reference.GetxVectorDouble(), 1e-9));
+            }
+        }
+
+        WHEN("the refinement is limited to no steps") {
+            MNAsolver solver = MNAsolver();
+            solver.SetMixedPrecision(true);
+            solver.SetRefinement(REFINEMENT_TOLERANCE, 0);
+            solver.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("only single precision accuracy is reached") {
+                CHECK(solver.GetRefinementSteps() == 0);
+                CHECK(solver.GetResidual() > REFINEMENT_TOLERANCE);
+                CHECK(solver.GetxVector().isApprox(reference.GetxVector(), 1e-4));
+            }
+        }
+
+        WHEN("a single precision matrix is solved in mixed mode") {
+            MNAsolver solver = MNAsolver();
+            solver.SetMixedPrecision(true);
+            solver.solveSteady(c.GetRealSparseAMatrix(), c.GetZMatrix(), c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("there is nothing to refine against") {
+                CHECK(solver.IsSolved());
+                CHECK_FALSE(solver.IsRefined());
+            }
+        }
+    }
+}
+
+SCENARIO("Iterative backends") {
+    GIVEN("Resistor mesh fed by a current source") {
+
+        Circuit c = Circuit();
+        std::shared_ptr<Node> g = c.AddNode("0");
+
+        const int size = 12;
+        for ( int i = 0; i < size; i++ ) {
+            for ( int j = 0; j < size; j++ ) {
+                std::string name = std::to_string(i) + "_" + std::to_string(j);
+                std::shared_ptr<Node> n = c.AddNode("N" + name);
+                if ( i > 0 ) {
+                    c.AddComponent(std::make_shared<Resistor>("RV" + name, 1, c.AddNode("N" + std::to_string(i - 1) + "_" + std::to_string(j)), n));
+                }
+                if ( j > 0 ) {
+                    c.AddComponent(std::make_shared<Resistor>("RH" + name, 1, c.AddNode("N" + std::to_string(i) + "_" + std::to_string(j - 1)), n));
+                }
+                c.AddComponent(std::make_shared<Resistor>("RG" + name, 100, n, g));
+            }
+        }
+        c.AddComponent(std::make_shared<CurrentSource>("J1", 1, g, c.AddNode("N0_0")));
+        c.ConstructMatrices();
+
+        SparseMatrix<double> A;
+        VectorXd z;
+        c.AssembleMatrices(c.GetOmega(), A, z);
+
+        MNAsolver direct = MNAsolver();
+        direct.SetBackend(SPARSE_LU);
+        direct.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+        WHEN("solved with every Krylov method") {
+            SolverBackendType types[] = { CONJUGATE_GRADIENT, BICGSTAB_ILU0, BICGSTAB_ILUT, GMRES_ILU0, GMRES_ILUT };
+
+            THEN("all converge to the direct solution") {
+                for ( auto type : types ) {
+                    MNAsolver solver = MNAsolver();
+                    solver.SetBackend(type);
+                    solver.SetIterativeTolerance(1e-10, 500);
+                    solver.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+                    CHECK(solver.IsSolved());
+                    CHECK(solver.IsIterative());
+                    CHECK(solver.GetIterations() > 0);
+                    CHECK(solver.GetIterativeError() <= 1e-10);
+                    CHECK(solver.GetxVectorDouble().isApprox(direct.GetxVectorDouble(), 1e-8));
+                }
+            }
+        }
+
+        WHEN("the same system is solved again") {
+            MNAsolver solver = MNAsolver();
+            solver.SetBackend(CONJUGATE_GRADIENT);
+            solver.SetIterativeTolerance(1e-10, 500);
+            solver.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+            int cold = solver.GetIterations();
+            solver.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("it is warm started from the previous solution") {
+                CHECK(solver.IsSolved());
+                CHECK(solver.GetIterations() < cold);
+            }
+        }
+
+        WHEN("the iteration cap is hit") {
+            MNAsolver solver = MNAsolver();
+            solver.SetBackend(BICGSTAB_ILU0);
+            solver.SetIterativeTolerance(1e-14, 1);
+            solver.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("the solve is reported as failed") {
+                CHECK_FALSE(solver.IsSolved());
+                CHECK(solver.GetIterations() == 1);
+            }
+        }
+    }
+
+    GIVEN("AC circuit with a voltage source row") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+        std::shared_ptr<Node> n3 = c.AddNode("N3");
+
+        c.AddComponent(std::make_shared<Resistor>("R1", 100, n1, n2));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.005, n2, n3));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.00002, n3, g));
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 12, g, n1));
+        c.SetOmega( 314.159265359 );
+        c.ConstructMatrices();
+
+        WHEN("solved with ILU(0) preconditioned GMRES") {
+            MNAsolver solver = MNAsolver();
+            solver.SetBackend(GMRES_ILU0);
+            solver.solveSteady(c.GetSparseAMatrix(), c.GetZMatrix(), c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            Eigen::VectorXcf Refx = MatrixXcf::Zero(4, 1);
+            Refx << cd(8.48528,0), cd(6.04926,-3.83876), cd(6.10956,-3.87703), cd(-0.0243602,-0.0383876);
+
+            THEN("the zero diagonal of the source row is handled") {
+                CHECK(solver.IsSolved());
+                CHECK(solver.GetBackendName() == "GMRES+ILU0");
+                CHECK(solver.GetxVector().isApprox(Refx, 1e-4));
+            }
+        }
+    }
+}
+
+SCENARIO("Algebraic multigrid") {
+    GIVEN("Resistor grid of a power distribution network") {
+
+        Circuit c = ResistorGrid(40);
+        c.ConstructMatrices();
+
+        SparseMatrix<double> A;
+        VectorXd z;
+        c.AssembleMatrices(c.GetOmega(), A, z);
+
+        MNAsolver direct = MNAsolver();
+        direct.SetBackend(SPARSE_LDLT);
+        direct.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+        WHEN("the hierarchy is built") {
+            AlgebraicMultigrid<double> multigrid(A);
+
+            THEN("the grid is coarsened to a few levels") {
+                CHECK(multigrid.info() == Success);
+                CHECK(multigrid.levels() > 1);
+                CHECK(multigrid.operatorComplexity() < 2);
+            }
+        }
+
+        WHEN("solved with multigrid cycles and multigrid preconditioned CG") {
+            SolverBackendType types[] = { MULTIGRID, CONJUGATE_GRADIENT_AMG };
+
+            THEN("both converge to the direct solution") {
+                for ( auto type : types ) {
+                    MNAsolver solver = MNAsolver();
+                    solver.SetBackend(type);
+                    solver.SetIterativeTolerance(1e-10, 200);
+                    solver.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+                    CHECK(solver.IsSolved());
+                    CHECK(solver.GetxVectorDouble().isApprox(direct.GetxVectorDouble(), 1e-8));
+                }
+            }
+        }
+
+        WHEN("a solve stops before converging and the matrix is factorized again") {
+            SolverBackendType types[] = { MULTIGRID, CONJUGATE_GRADIENT_AMG };
+
+            THEN("the failed solve does not fail the factorization") {
+                for ( auto type : types ) {
+                    std::unique_ptr<SolverBackend<double>> backend = CreateBackend<double>(type);
+                    backend->SetTolerance(1e-14, 1);
+                    REQUIRE(backend->Analyze(A));
+                    REQUIRE(backend->Factorize(A));
+                    backend->Solve(z);
+                    CHECK(!backend->Converged());
+
+                    backend->SetTolerance(1e-10, 200);
+                    CHECK(backend->Factorize(A));
+                    VectorXd x = backend->Solve(z);
+                    CHECK(backend->Converged());
+                    CHECK(x.isApprox(direct.GetxVectorDouble(), 1e-8));
+                }
+            }
+        }
+
+        WHEN("the grid is refined") {
+            int iterations[2];
+            int sizes[] = { 20, 80 };
+            for ( int k = 0; k < 2; k++ ) {
+                Circuit grid = ResistorGrid(sizes[k]);
+                grid.ConstructMatrices();
+                SparseMatrix<double> G;
+                VectorXd s;
+                grid.AssembleMatrices(grid.GetOmega(), G, s);
+
+                MNAsolver solver = MNAsolver();
+                solver.SetBackend(CONJUGATE_GRADIENT_AMG);
+                solver.SetIterativeTolerance(1e-8, 200);
+                solver.solveSteady(G, s, grid.GetOmega(), grid.GetNodeIndexes(), grid.GetVoltageSourceIndexes(), grid.GetInductorIndexes());
+                CHECK(solver.IsSolved());
+                iterations[k] = solver.GetIterations();
+            }
+
+            THEN("the iteration count barely grows") {
+                CHECK(iterations[1] <= iterations[0] + 5);
+            }
+        }
+    }
+}
+
+SCENARIO("Fill-reducing orderings") {
+    GIVEN("Resistor grid") {
+
+        Circuit c = ResistorGrid(30);
+        c.ConstructMatrices();
+        SparseMatrix<double> A = c.GetGMatrix();
+        VectorXd z = c.GetSourceVector();
+
+        WHEN("the fill of each ordering is analyzed") {
+            FillStatistics natural = AnalyzeFill(A, NATURAL_ORDERING);
+            FillStatistics amd = AnalyzeFill(A, AMD_ORDERING);
+            FillStatistics rcm = AnalyzeFill(A, RCM_ORDERING);
+
+            THEN("the statistics describe the factors") {
+                CHECK(natural.nonzeros == A.nonZeros());
+                CHECK(natural.factor_nonzeros >= A.nonZeros());
+                CHECK(natural.fill_ratio == doctest::Approx(double(natural.factor_nonzeros) / A.nonZeros()));
+                CHECK(amd.factor_nonzeros < natural.factor_nonzeros);
+                CHECK(amd.flops < natural.flops);
+                CHECK(rcm.factor_nonzeros <= natural.factor_nonzeros);
+            }
+
+            THEN("AMD matches the factor SimplicialLDLT computes with it") {
+                SimplicialLDLT<SparseMatrix<double>, Lower, NaturalOrdering<int>> ldlt;
+                PermutationMatrix<Dynamic, Dynamic, int> P = ComputeOrdering(A, AMD_ORDERING);
+                ldlt.compute(SparseMatrix<double>(P * A * P.transpose()));
+                long L = ldlt.matrixL().nestedExpression().nonZeros();  // unit diagonal not stored
+                CHECK(amd.factor_nonzeros == 2 * L + A.rows());
+            }
+        }
+
+        WHEN("solved with every ordering") {
+            MNAsolver reference = MNAsolver();
+            reference.SetBackend(SPARSE_LU);
+            reference.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            OrderingType orderings[] = { NATURAL_ORDERING, AMD_ORDERING, COLAMD_ORDERING, RCM_ORDERING };
+            SolverBackendType types[] = { SPARSE_LU, SPARSE_LDLT };
+
+            THEN("the solution does not depend on the ordering") {
+                for ( auto type : types ) {
+                    for ( auto ordering : orderings ) {
+                        MNAsolver solver = MNAsolver();
+                        solver.SetBackend(type);
+                        solver.SetOrdering(ordering);
+                        solver.SetFillStatistics(true);
+                        solver.solveSteady(A, z, c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+                        CHECK(solver.IsSolved());
+                        CHECK(solver.GetFillStatistics().ordering == ordering);
+                        CHECK(solver.GetxVectorDouble().isApprox(reference.GetxVectorDouble(), 1e-10));
+                    }
+                }
+            }
+        }
+    }
+
+    GIVEN("Circuit with a voltage source and an inductor") {
+
+        Circuit c = Circuit();
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+        std::shared_ptr<Node> n3 = c.AddNode("N3");
+
+        c.AddComponent(std::make_shared<Resistor>("R1", 100, n1, n2));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.005, n2, n3));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.00002, n3, g));
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 12, g, n1));
+        c.SetOmega( 314.159265359 );
+        c.ConstructMatrices();
+
+        WHEN("solved with a reverse Cuthill-McKee ordering") {
+            MNAsolver solver = MNAsolver();
+            solver.SetBackend(SPARSE_LU);
+            solver.SetOrdering(RCM_ORDERING);
+            solver.SetFillStatistics(true);
+            solver.solveSteady(c.GetSparseAMatrix(), c.GetZMatrix(), c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            Eigen::VectorXcf Refx = MatrixXcf::Zero(4, 1);
+            Refx << cd(8.48528,0), cd(6.04926,-3.83876), cd(6.10956,-3.87703), cd(-0.0243602,-0.0383876);
+
+            std::stringstream listed;
+            solver.resultListed(listed);
+
+            THEN("the zero diagonal is pivoted and the statistics are listed") {
+                CHECK(solver.IsSolved());
+                CHECK(solver.GetxVector().isApprox(Refx, 1e-4));
+                CHECK(listed.str().find("Ordering: RCM, nnz(A) ") != std::string::npos);
+            }
+        }
+    }
+}
+
+SCENARIO("Low-rank updates of the factorization") {
+    GIVEN("A resistor grid solved once with low-rank updates") {
+
+        Circuit c = ResistorGrid(20);
+        c.ConstructMatrices();
+
+        MNAsolver solver = MNAsolver();
+        solver.SetBackend(SPARSE_LU);
+        solver.SetLowRankUpdates(4);
+        solver.solveSteady<double>(c.GetGMatrix(), c.GetSourceVector(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+        CHECK_FALSE(solver.IsLowRankUpdated());
+
+        std::list<std::shared_ptr<Component>> components = c.GetComponents();
+        std::vector<std::shared_ptr<Component>> resistors;
+        for ( auto const& component : components ) {
+            if ( component->GetType() == RESISTOR ) {
+                resistors.push_back(component);
+            }
+        }
+        std::shared_ptr<Component> r1 = resistors[0];
+
+        MNAsolver reference = MNAsolver();
+        reference.SetBackend(SPARSE_LU);
+
+        WHEN("one resistor is edited several times") {
+            for ( float value : { 5.0f, 0.2f, 30.0f } ) {
+                r1->SetValue(value);
+                c.ConstructMatrices();
+                solver.solveSteady<double>(c.GetGMatrix(), c.GetSourceVector(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+            }
+            reference.solveSteady<double>(c.GetGMatrix(), c.GetSourceVector(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("the update of its two rows gives the refactored solution") {
+                CHECK(solver.IsLowRankUpdated());
+                CHECK(solver.GetUpdateRank() == 2);
+                CHECK(solver.GetxVectorDouble().isApprox(reference.GetxVectorDouble(), 1e-9));
+            }
+        }
+
+        WHEN("more rows change than the update allows") {
+            r1->SetValue(5);
+            resistors[200]->SetValue(5);
+            resistors[400]->SetValue(5);
+            c.ConstructMatrices();
+            solver.solveSteady<double>(c.GetGMatrix(), c.GetSourceVector(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+            reference.solveSteady<double>(c.GetGMatrix(), c.GetSourceVector(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("the matrix is factored again") {
+                CHECK_FALSE(solver.IsLowRankUpdated());
+                CHECK(solver.GetxVectorDouble().isApprox(reference.GetxVectorDouble(), 1e-9));
+            }
+        }
+
+        WHEN("only a source is edited") {
+            for ( auto const& component : components ) {
+                if ( component->GetType() == CURRENT_SOURCE ) {
+                    component->SetValue(2 * component->GetValue());
+                    break;
+                }
+            }
+            c.ConstructMatrices();
+            solver.solveSteady<double>(c.GetGMatrix(), c.GetSourceVector(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+            reference.solveSteady<double>(c.GetGMatrix(), c.GetSourceVector(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("the factorization is used as it is") {
+                CHECK(solver.IsLowRankUpdated());
+                CHECK(solver.GetUpdateRank() == 0);
+                CHECK(solver.GetxVectorDouble().isApprox(reference.GetxVectorDouble(), 1e-9));
+            }
+        }
+    }
+}
+
+SCENARIO("Branch currents") {
+    GIVEN("A circuit with an inductor in parallel with a resistor") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+        std::shared_ptr<Node> n3 = c.AddNode("N3");
+
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 5, g, n1));
+        c.AddComponent(std::make_shared<Resistor>("R1", 10, n1, n2));
+        c.AddComponent(std::make_shared<Resistor>("R2", 10, n2, n3));
+        c.AddComponent(std::make_shared<Resistor>("R3", 5, n3, g));
+        c.AddComponent(std::make_shared<Resistor>("R4", 20, n1, n3));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.001, n2, g));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.001, n1, n3));
+
+        WHEN("solved at DC") {
+            c.ConstructMatrices();
+            MNAsolver solver = MNAsolver();
+            solver.solveSteady(c.GetAMatrix(), c.GetZMatrix(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+            solver.setCurrents(c.GetComponents(), 0);
+            std::map<std::string, cd> currents = solver.GetComponentCurrents();
+
+            THEN("the inductor shorts the resistor across it") {
+                CHECK(currents.at("R4") == cd(0, 0));
+                CHECK(currents.at("R3").real() == doctest::Approx(1));
+                CHECK(std::abs(currents.at("R1")) < 1e-5);
+                CHECK(currents.at("C1") == cd(0, 0));
+                CHECK(currents.at("L1").real() == doctest::Approx(1));
+            }
+        }
+
+        WHEN("solved at AC") {
+            float omega = 314;
+            c.SetOmega(omega);
+            c.ConstructMatrices();
+            MNAsolver solver = MNAsolver();
+            solver.solveSteady(c.GetAMatrix(), c.GetZMatrix(), omega, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+            solver.setCurrents(c.GetComponents(), omega);
+            std::map<std::string, cd> currents = solver.GetComponentCurrents();
+            std::map<std::string, cd> v = solver.GetNodeVoltages();
+
+            THEN("every current is Y (V_in - V_out)") {
+                CHECK(std::abs(currents.at("R4") - (v["N1"] - v["N3"]) / 20.0f) < 1e-5);
+                CHECK(std::abs(currents.at("R3") - v["N3"] / 5.0f) < 1e-5);
+                CHECK(std::abs(currents.at("C1") - cd(0, 0.001f * omega) * v["N2"]) < 1e-5);
+                CHECK(std::abs(currents.at("L1") - (v["N1"] - v["N3"]) / cd(0, 0.001f * omega)) < 1e-4);
+            }
+        }
+    }
+}
+
+SCENARIO("Solving a constructed circuit in place") {
+    GIVEN("A circuit with every kind of component") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+        std::shared_ptr<Node> n3 = c.AddNode("N3");
+
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 5, g, n1));
+        std::shared_ptr<Resistor> r1 = std::make_shared<Resistor>("R1", 10, n1, n2);
+        c.AddComponent(r1);
+        c.AddComponent(std::make_shared<Resistor>("R2", 10, n2, n3));
+        c.AddComponent(std::make_shared<Resistor>("R3", 5, n3, g));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.001, n2, g));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.001, n1, n3));
+        c.AddComponent(std::make_shared<CurrentSource>("I1", 1, g, n2));
+
+        WHEN("the circuit is solved in every storage") {
+            AssemblyMode modes[] = {DENSE_ASSEMBLY, SPARSE_ASSEMBLY};
+            float omegas[] = {0, 314};
+
+            THEN("the solution matches the one from copied matrices") {
+                for ( AssemblyMode mode : modes ) {
+                    for ( float omega : omegas ) {
+                        c.SetAssemblyMode(mode);
+                        c.SetOmega(omega);
+                        c.ConstructMatrices();
+                        MNAsolver solver = MNAsolver();
+                        solver.solveSteady(c);
+                        MNAsolver reference = MNAsolver();
+                        reference.solveSteady(c.GetAMatrix(), c.GetZMatrix(), omega, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+                        CHECK(solver.IsSolved());
+                        CHECK(solver.IsReal() == (omega == 0));
+                        CHECK(solver.GetxVector().isApprox(reference.GetxVector(), 1e-4));
+                        CHECK(solver.GetNodeVoltages().size() == 3);
+                        CHECK(std::abs(solver.GetNodeVoltages().at("N2") - reference.GetNodeVoltages().at("N2")) < 1e-4);
+                    }
+                }
+            }
+        }
+
+        WHEN("the circuit is edited and solved again") {
+            c.SetAssemblyMode(SPARSE_ASSEMBLY);
+            c.ConstructMatrices();
+            MNAsolver solver = MNAsolver();
+            solver.solveSteady(c);
+            const std::complex<double>* data = solver.GetxVectorDouble().data();
+            const cd* voltage = &solver.GetNodeVoltages().at("N2");
+
+            r1->SetValue(20);
+            c.ConstructMatrices();
+            solver.solveSteady(c);
+            MNAsolver reference = MNAsolver();
+            reference.solveSteady(c.GetAMatrix(), c.GetZMatrix(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+
+            THEN("the solution and the results are written into the same storage") {
+                CHECK(solver.GetxVectorDouble().data() == data);
+                CHECK(&solver.GetNodeVoltages().at("N2") == voltage);
+                CHECK(solver.GetxVector().isApprox(reference.GetxVector(), 1e-4));
+                CHECK(c.GetRealSparseAMatrix().isApprox(c.GetGMatrix().cast<float>()));
+            }
+        }
+
+        WHEN("the indexes are read") {
+            c.ConstructMatrices();
+
+            THEN("they are not copied") {
+                CHECK(&c.GetNodeIndexes() == &c.GetNodeIndexes());
+                CHECK(&c.GetZMatrix() == &c.GetZMatrix());
+            }
+        }
+    }
+}
+
+SCENARIO("Result store") {
+    GIVEN("A solved circuit") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 5, g, n1));
+        c.AddComponent(std::make_shared<Resistor>("R1", 10, n1, n2));
+        c.AddComponent(std::make_shared<Resistor>("R2", 10, n2, g));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.001, n2, g));
+        c.ConstructMatrices();
+
+        MNAsolver solver = MNAsolver();
+        solver.solveSteady(c);
+        const SimulationResults& results = solver.GetResults();
+
+        WHEN("values are looked up by name") {
+            int n2_index = results.GetIndex("N2");
+            int source_index = results.GetIndex("S1");
+            int inductor_index = results.GetIndex("L1");
+
+            THEN("they are found by the indexes of the circuit") {
+                CHECK(results.GetRows() == c.GetZMatrix().rows());
+                CHECK(results.GetColumns() == 1);
+                CHECK(results.GetPoints()[0] == 0);
+                CHECK(n2_index == c.GetNodeIndexes().at("N2"));
+                CHECK(results.GetType(n2_index) == NODE_VOLTAGE);
+                CHECK(results.GetType(source_index) == VOLTAGE_SOURCE_CURRENT);
+                CHECK(results.GetType(inductor_index) == INDUCTOR_CURRENT);
+                CHECK(results.GetName(inductor_index) == "L1");
+                CHECK(results.GetIndex("R1") == -1);
+                CHECK(results.Get(n2_index, 0) == solver.GetNodeVoltages().at("N2"));
+                CHECK(results.Get(inductor_index, 0).real() == doctest::Approx(0.5));
+                CHECK(results.GetColumn(0).isApprox(solver.GetxVector()));
+            }
+        }
+
+        WHEN("values are looked up by node and component id") {
+            solver.setCurrents(c.GetComponents(), 0);
+
+            THEN("node rows follow the node ids and passive currents the component ids") {
+                CHECK(results.GetNodeIndex(n1->GetId()) == c.GetNodeIndexes().at("N1"));
+                CHECK(results.GetNodeIndex(g->GetId()) == -1);
+                CHECK(results.GetVoltage(n1->GetId(), 0) == solver.GetNodeVoltages().at("N1"));
+                CHECK(results.GetComponentCount() == 4);
+                CHECK(results.GetCurrent(results.GetComponentId("R1"), 0).real() == doctest::Approx(0.5));
+                CHECK(results.GetCurrent(results.GetComponentId("R2"), 0) == cd(0, 0));
+                CHECK(results.GetCurrent(results.GetComponentId("L1"), 0).real() == doctest::Approx(0.5));
+                CHECK(results.GetCurrent(results.GetComponentId("S1"), 0) == cd(0, 0));
+            }
+        }
+
+        WHEN("columns are added") {
+            SimulationResults store = results;
+            for ( int k = 1; k < 4; k++ ) {
+                CHECK(store.AddColumn(k, VectorXcf::Constant(store.GetRows(), cd(k, 0))));
+            }
+
+            THEN("every point is a column and a row reads across them") {
+                CHECK(!store.AddColumn(4, VectorXcf::Zero(1)));
+                CHECK(store.GetColumns() == 4);
+                CHECK(store.GetValues().cols() == 4);
+                CHECK(store.GetColumn(2).isApprox(VectorXcf::Constant(store.GetRows(), cd(2, 0))));
+                int index = store.GetIndex("N1");
+                SimulationResults::Trace trace = store.GetTrace(index);
+                CHECK(trace.size() == 4);
+                for ( int k = 1; k < 4; k++ ) {
+                    CHECK(trace(k) == cd(k, 0));
+                    CHECK(store.GetPoints()[k] == k);
+                }
+                CHECK(trace(0) == solver.GetNodeVoltages().at("N1"));
+            }
+        }
+
+        WHEN("the results are listed") {
+            std::stringstream out;
+            results.resultListed(out);
+
+            THEN("every named row has a column") {
+                std::string header;
+                std::getline(out, header);
+                CHECK(header == "point N1[V] N2[V] L1[A] S1[A]");
+            }
+        }
+    }
+}
+
+SCENARIO("Solving islands") {
+    GIVEN("A circuit of several ladders that only share ground") {
+
+        Circuit c = Circuit();
+        c.SetAssemblyMode(SPARSE_ASSEMBLY);
+        std::shared_ptr<Node> g = c.AddNode("0");
+
+        const int ladders = 5;
+        for ( int k = 0; k < ladders; k++ ) {
+            std::string prefix = "L" + std::to_string(k) + "N";
+            std::shared_ptr<Node> previous = c.AddNode(prefix + "0");
+            c.AddComponent(std::make_shared<VoltageSource>("S" + std::to_string(k), k + 1, g, previous));
+            for ( int i = 1; i < 20 + 10 * k; i++ ) {
+                std::shared_ptr<Node> node = c.AddNode(prefix + std::to_string(i));
+                c.AddComponent(std::make_shared<Resistor>("R" + std::to_string(k) + "_" + std::to_string(i), 10, previous, node));
+                c.AddComponent(std::make_shared<Resistor>("G" + std::to_string(k) + "_" + std::to_string(i), 100, node, g));
+                c.AddComponent(std::make_shared<Capacitor>("C" + std::to_string(k) + "_" + std::to_string(i), 0.001, node, g));
+                previous = node;
+            }
+        }
+
+        WHEN("solved at DC and AC") {
+            float omegas[] = {0, 100};
+
+            THEN("every island matches the solve of the whole matrix") {
+                for ( float omega : omegas ) {
+                    c.SetOmega(omega);
+                    c.ConstructMatrices();
+                    REQUIRE(c.GetIslandCount() == ladders);
+
+                    MNAsolver solver = MNAsolver();
+                    solver.SetThreadCount(3);
+                    solver.solveSteady(c);
+                    MNAsolver whole = MNAsolver();
+                    whole.SetIslandSolving(false);
+                    whole.solveSteady(c);
+
+                    CHECK(solver.IsSolved());
+                    CHECK(solver.GetIslandCount() == ladders);
+                    CHECK(whole.GetIslandCount() == 1);
+                    CHECK(solver.GetxVector().isApprox(whole.GetxVector(), 1e-4));
+                    CHECK(std::abs(solver.GetNodeVoltages().at("L3N0") - whole.GetNodeVoltages().at("L3N0")) < 1e-5);
+                }
+            }
+        }
+
+        WHEN("solved again after an edit") {
+            c.ConstructMatrices();
+            MNAsolver solver = MNAsolver();
+            solver.solveSteady(c);
+            std::shared_ptr<Component> resistor;
+            for ( auto const& component : c.GetComponents() ) {
+                if ( component->GetType() == RESISTOR ) {
+                    resistor = component;
+                    break;
+                }
+            }
+            resistor->SetValue(50);
+            c.ConstructMatrices();
+            solver.solveSteady(c);
+            MNAsolver whole = MNAsolver();
+            whole.SetIslandSolving(false);
+            whole.solveSteady(c);
+
+            THEN("the analysis of every island is reused") {
+                CHECK(solver.ReusedAnalysis());
+                CHECK(solver.GetxVector().isApprox(whole.GetxVector(), 1e-4));
+            }
+        }
+    }
+}
+
+SCENARIO("Domain decomposition") {
+    GIVEN("Two and three dimensional RC meshes") {
+
+        Circuit flat = ResistorMesh(24, 24, 1, 10, 1e-3);
+        Circuit cube = ResistorMesh(8, 8, 8, 10, 1e-3);
+        Circuit* meshes[] = { &flat, &cube };
+
+        WHEN("the graph is partitioned") {
+            flat.ConstructMatrices();
+            SparseMatrix<double> A = flat.GetGMatrix();
+            std::vector<int> part = PartitionGraph(A, 4);
+
+            THEN("only separators connect the parts") {
+                std::vector<int> sizes(4, 0);
+                int separators = 0;
+                int crossing = 0;
+                for ( int col = 0; col < A.outerSize(); col++ ) {
+                    part[col] < 0 ? separators++ : sizes[part[col]]++;
+                    for ( SparseMatrix<double>::InnerIterator it(A, col); it; ++it ) {
+                        if ( part[it.row()] >= 0 && part[col] >= 0 && part[it.row()] != part[col] ) {
+                            crossing++;
+                        }
+                    }
+                }
+                CHECK(crossing == 0);
+                for ( int size : sizes ) {
+                    CHECK(size > A.rows() / 8);
+                }
+                CHECK(separators < A.rows() / 5);
+            }
+        }
+
+        WHEN("solved with the Schur complement at DC and AC") {
+            float omegas[] = {0, 1000};
+
+            THEN("the solution matches SparseLU") {
+                for ( Circuit* mesh : meshes ) {
+                    for ( float omega : omegas ) {
+                        mesh->SetOmega(omega);
+                        mesh->ConstructMatrices();
+
+                        MNAsolver reference = MNAsolver();
+                        reference.SetBackend(SPARSE_LU);
+                        reference.solveSteady(*mesh);
+                        MNAsolver solver = MNAsolver();
+                        solver.SetBackend(SCHUR_COMPLEMENT);
+                        solver.solveSteady(*mesh);
+
+                        CHECK(solver.IsSolved());
+                        CHECK(solver.GetBackendName() == "SchurComplement");
+                        CHECK(solver.GetxVector().isApprox(reference.GetxVector(), 1e-4));
+                        CHECK(SelectBackend(mesh->GetMatrixProperties()) != SCHUR_COMPLEMENT);
+                    }
+                }
+            }
+        }
+
+        WHEN("the backend is used directly") {
+            cube.ConstructMatrices();
+            SparseMatrix<double> A;
+            VectorXd z;
+            cube.AssembleMatrices(cube.GetOmega(), A, z);
+            SchurComplementBackend<double> backend(4, 2);
+            REQUIRE(backend.Compute(A));
+            VectorXd x = backend.Solve(z);
+
+            THEN("the interface is small and the residual is at round-off") {
+                CHECK(backend.GetDomainCount() == 4);
+                CHECK(backend.GetInterfaceSize() > 0);
+                CHECK(backend.GetInterfaceSize() < A.rows() / 2);
+                CHECK((A * x - z).norm() < 1e-10 * z.norm());
+            }
+        }
+    }
+}
+
+SCENARIO("Solving a reduced circuit") {
+    GIVEN("A resistor mesh with inductor shorts and grounded sources") {
+
+        Circuit c = ResistorMesh(12, 12, 1, 10);
+        std::shared_ptr<Node> g = c.AddNode("0");
+        for ( int i = 0; i < 12; i++ ) {
+            std::string top = "N" + std::to_string(i) + "_0_0";
+            std::string next = "N" + std::to_string(i) + "_1_0";
+            c.AddComponent(std::make_shared<Inductor>("LS" + std::to_string(i), 0.001, c.AddNode(top), c.AddNode(next)));
+        }
+        std::shared_ptr<Node> pad = c.AddNode("PAD");
+        c.AddComponent(std::make_shared<VoltageSource>("VB", 2, g, pad));
+        c.AddComponent(std::make_shared<Inductor>("LB", 0.001, pad, c.AddNode("N5_5_0")));
+        c.AddComponent(std::make_shared<Inductor>("LG", 0.001, c.AddNode("N11_11_0"), g));
+        c.AddComponent(std::make_shared<CurrentSource>("IL", 0.5, c.AddNode("N8_2_0"), g));
+
+        WHEN("solved with and without the reduction") {
+            c.ConstructMatrices();
+            MNAsolver full = MNAsolver();
+            full.solveSteady(c);
+            full.setCurrents(c.GetComponents(), c.GetOmega());
+            int dimension = c.GetReducedDimension();
+
+            c.SetTopologyReduction(true);
+            c.ConstructMatrices();
+            MNAsolver reduced = MNAsolver();
+            reduced.solveSteady(c);
+            reduced.setCurrents(c.GetComponents(), c.GetOmega());
+
+            THEN("the system is smaller and the results are the same") {
+                CHECK(c.IsReduced());
+                CHECK(c.GetReducedDimension() < dimension - 12);
+                CHECK(full.IsSolved());
+                CHECK(reduced.IsSolved());
+                CHECK(reduced.GetxVector().rows() == dimension);
+                auto difference = [](const std::map<std::string, cd>& a, const std::map<std::string, cd>& b) {
+                    float largest = a.size() == b.size() ? 0 : 1;
+                    for ( auto const& value : a ) {
+                        largest = b.count(value.first) ? std::max(largest, std::abs(b.at(value.first) - value.second)) : 1;
+                    }
+                    return largest;
+                };
+                CHECK(difference(full.GetNodeVoltages(), reduced.GetNodeVoltages()) < 1e-4);
+                CHECK(difference(full.GetVoltageSourceCurrents(), reduced.GetVoltageSourceCurrents()) < 1e-4);
+                CHECK(difference(full.GetComponentCurrents(), reduced.GetComponentCurrents()) < 1e-4);
+            }
+
+            THEN("the index based solve still gets the full system") {
+                CHECK(c.GetRealSparseAMatrix().rows() == dimension);
+                CHECK(c.GetZMatrix().rows() == dimension);
+                CHECK(c.GetReducedAMatrix().rows() == c.GetReducedDimension());
+                MNAsolver indexed = MNAsolver();
+                indexed.solveSteady(c.GetSparseAMatrix(), c.GetZMatrix(), 0, c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+                CHECK(indexed.IsSolved());
+                CHECK(indexed.GetxVector().isApprox(reduced.GetxVector(), 1e-4));
+            }
+        }
+    }
+}
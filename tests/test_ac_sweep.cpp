@@ -0,0 +1,153 @@
+#include <string>
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include "doctest.h"
+#include "ac_sweep.hpp"
+#include "MNAsolver.hpp"
+#include "circuit.hpp"
+#include "resistor.hpp"
+#include "inductor.hpp"
+#include "capacitor.hpp"
+#include "voltage_source.hpp"
+#include "node.hpp"
+#include "Eigen/Dense"
+
+typedef std::complex<float> cd;
+
+SCENARIO("Generating sweep points") {
+    GIVEN("A frequency range") {
+
+        WHEN("points are spaced linearly") {
+            std::vector<float> w = ACSweep::SweepPoints(10, 100, 10, LINEAR_SWEEP);
+
+            THEN("the range is split evenly") {
+                CHECK(w.size() == 10);
+                CHECK(w.front() == doctest::Approx(10));
+                CHECK(w[1] == doctest::Approx(20));
+                CHECK(w.back() == doctest::Approx(100));
+            }
+        }
+
+        WHEN("points are spaced per decade") {
+            std::vector<float> w = ACSweep::SweepPoints(1, 1000, 10, DECADE_SWEEP);
+
+            THEN("every decade has the given number of points") {
+                CHECK(w.size() == 31);
+                CHECK(w[10] == doctest::Approx(10));
+                CHECK(w.back() == doctest::Approx(1000));
+            }
+        }
+
+        WHEN("points are spaced per octave") {
+            std::vector<float> w = ACSweep::SweepPoints(1, 8, 2, OCTAVE_SWEEP);
+
+            THEN("every octave has the given number of points") {
+                CHECK(w.size() == 7);
+                CHECK(w[2] == doctest::Approx(2));
+            }
+        }
+    }
+}
+
+SCENARIO("Sweeping a RLC circuit") {
+    GIVEN("Series RLC circuit") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n1 = c.AddNode("N1");
+        std::shared_ptr<Node> n2 = c.AddNode("N2");
+        std::shared_ptr<Node> n3 = c.AddNode("N3");
+
+        c.AddComponent(std::make_shared<Resistor>("R1", 100, n1, n2));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.005, n2, n3));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.00002, n3, g));
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 12, g, n1));
+
+        WHEN("swept on several threads") {
+            ACSweep sweep = ACSweep(100, 100000, 20, DECADE_SWEEP);
+            sweep.SetThreadCount(4);
+            sweep.Run(c);
+
+            THEN("every point matches a single frequency solve") {
+                CHECK(sweep.IsSolved());
+                CHECK(sweep.GetxMatrix().cols() == sweep.GetOmegas().size());
+                CHECK(sweep.GetNodeVoltages().rows() == 3);
+                CHECK(sweep.GetVoltageSourceCurrents().rows() == 1);
+
+                for ( int k = 0; k < sweep.GetxMatrix().cols(); k += 7 ) {
+                    c.SetOmega(sweep.GetOmegas()[k]);
+                    c.ConstructMatrices();
+                    MNAsolver solver = MNAsolver();
+                    solver.solveSteady(c.GetAMatrix(), c.GetZMatrix(), c.GetOmega(), c.GetNodeIndexes(), c.GetVoltageSourceIndexes(), c.GetInductorIndexes());
+                    CHECK(solver.GetxVector().isApprox(sweep.GetxMatrix().col(k), 1e-4));
+                }
+            }
+
+            THEN("the passive components carry the series current at every point") {
+                VectorXcf resistor = sweep.GetComponentResponse("R1");
+                CHECK(resistor.size() == sweep.GetOmegas().size());
+                CHECK(resistor.isApprox(sweep.GetComponentResponse("L1"), 1e-4));
+                CHECK(resistor.isApprox(sweep.GetComponentResponse("C1"), 1e-4));
+                CHECK(sweep.GetComponentResponse("S1").isZero());
+
+                int k = 10;
+                c.SetOmega(sweep.GetOmegas()[k]);
+                c.ConstructMatrices();
+                MNAsolver solver = MNAsolver();
+                solver.solveSteady(c);
+                solver.setCurrents(c.GetComponents(), c.GetOmega());
+                CHECK(std::abs(solver.GetComponentCurrents().at("R1") - resistor(k)) < 1e-4 * std::abs(resistor(k)));
+            }
+
+            THEN("source node response is flat") {
+                VectorXcf response = sweep.GetNodeResponse("N1");
+                CHECK(response.size() == sweep.GetOmegas().size());
+                CHECK(response(0) == cd(12 * 0.70710678118, 0));
+                CHECK(response(response.size() - 1) == response(0));
+            }
+        }
+
+        WHEN("swept with an iterative backend") {
+            ACSweep direct = ACSweep(100, 100000, 20, DECADE_SWEEP);
+            direct.Run(c);
+
+            ACSweep iterative = ACSweep(100, 100000, 20, DECADE_SWEEP);
+            iterative.SetBackend(BICGSTAB_ILU0);
+            iterative.SetThreadCount(1);
+            iterative.Run(c);
+
+            THEN("every point converges to the direct solution") {
+                CHECK(iterative.IsSolved());
+                CHECK(iterative.GetIterations() > 0);
+                CHECK(iterative.GetxMatrix().isApprox(direct.GetxMatrix(), 1e-4));
+            }
+
+            THEN("workers warm started from points of other workers converge as well") {
+                ACSweep threaded = ACSweep(100, 100000, 20, DECADE_SWEEP);
+                threaded.SetBackend(BICGSTAB_ILU0);
+                threaded.SetThreadCount(4);
+                threaded.Run(c);
+                CHECK(threaded.IsSolved());
+                CHECK(threaded.GetxMatrix().isApprox(direct.GetxMatrix(), 1e-4));
+            }
+        }
+
+        WHEN("swept in mixed precision") {
+            ACSweep single = ACSweep(100, 100000, 20, DECADE_SWEEP);
+            single.Run(c);
+
+            ACSweep mixed = ACSweep(100, 100000, 20, DECADE_SWEEP);
+            mixed.SetMixedPrecision(true);
+            mixed.Run(c);
+
+            THEN("every point is refined to double accuracy") {
+                CHECK(mixed.IsSolved());
+                CHECK(mixed.GetMaxResidual() < 1e-10);
+                CHECK(mixed.GetxMatrix().isApprox(single.GetxMatrix(), 1e-4));
+            }
+        }
+    }
+}
@@ -11,6 +11,7 @@
 #include "voltage_source.hpp"
 #include "current_source.hpp"
 #include "node.hpp"
+#include "circuit_generator.hpp"
 #include "Eigen/Dense"
 
 typedef std::complex<float> cd;
@@ -393,3 +394,624 @@ SCENARIO("Circuit with inductors and capacitors") {
         }
     }
 }
+
+SCENARIO("Frequency independent stamp matrices") {
+    GIVEN("Circuit with reactive elements") {
+
+        Circuit c = Circuit();
+
+        auto n1 = c.AddNode("N001");
+        auto n2 = c.AddNode("N002");
+        auto n3 = c.AddNode("N003");
+        auto g = c.AddNode("0");
+
+        c.AddComponent(std::make_shared<Resistor>("R2", 0.5, n1, n2));
+        c.AddComponent(std::make_shared<Resistor>("R1", 0.5, n3, g));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.001, n2, n3));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.005, n3, g));
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 4, g, n1));
+        c.SetOmega( 314 );
+
+        WHEN("Matrices are constructed") {
+            c.ConstructMatrices();
+
+            THEN("G, C and Gamma share the pattern of A") {
+                CHECK(c.GetGMatrix().nonZeros() == c.GetSparseAMatrix().nonZeros());
+                CHECK(c.GetCMatrix().nonZeros() == c.GetSparseAMatrix().nonZeros());
+                CHECK(c.GetGammaMatrix().nonZeros() == c.GetSparseAMatrix().nonZeros());
+            }
+
+            THEN("A is G + jwC + Gamma / (jw)") {
+                MatrixXf G = MatrixXf(c.GetGMatrix().cast<float>());
+                MatrixXf C = MatrixXf(c.GetCMatrix().cast<float>());
+                MatrixXf Gamma = MatrixXf(c.GetGammaMatrix().cast<float>());
+                MatrixXcf A = G.cast<cd>() + cd(0, 314) * C.cast<cd>() + Gamma.cast<cd>() / cd(0, 314);
+                CHECK(c.GetAMatrix().isApprox(A));
+            }
+
+            AND_WHEN("A is reassembled at another omega") {
+                SparseMatrix<cd> A = c.GetSparseAMatrix();
+                VectorXf z;
+                const cd* values = A.valuePtr();
+                c.AssembleMatrices(1000, A, z);
+
+                c.SetOmega( 1000 );
+                c.ConstructMatrices();
+
+                THEN("the existing storage is reused and values match a full construction") {
+                    CHECK(A.valuePtr() == values);
+                    CHECK(MatrixXcf(A).isApprox(c.GetAMatrix()));
+                    CHECK(z.isApprox(c.GetZMatrix()));
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Generating a resistor grid") {
+    GIVEN("A 10 x 10 grid") {
+
+        Circuit c = ResistorGrid(10);
+        c.ConstructMatrices();
+
+        THEN("it has a node per grid point and a nodal matrix") {
+            CHECK(c.GetNodes().size() == 101);
+            // 180 segments, 100 loads and a resistor and source per pad
+            CHECK(c.GetComponents().size() == 288);
+            CHECK(c.GetNodeIndexes().size() == 100);
+            CHECK(c.GetMatrixProperties().definite);
+        }
+    }
+}
+
+SCENARIO("Nodes and components have integer ids") {
+    GIVEN("A circuit with named and automatically named nodes") {
+
+        Circuit c = Circuit();
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> n0 = c.AddNode("N0");
+        std::shared_ptr<Node> n1 = c.AddNode();
+        std::shared_ptr<Node> n2 = c.AddNode();
+
+        THEN("ids are given in creation order and names are not reused") {
+            CHECK(g->GetId() == 0);
+            CHECK(n0->GetId() == 1);
+            CHECK(n1->GetId() == 2);
+            CHECK(n1->GetName() == "N1");
+            CHECK(n2->GetName() == "N2");
+            CHECK(c.AddNode("N0") == n0);
+            CHECK(c.GetNode(2) == n1);
+        }
+
+        WHEN("components are added and the matrices constructed") {
+            std::shared_ptr<Resistor> r1 = std::make_shared<Resistor>("R1", 10, n2, n1);
+            std::shared_ptr<VoltageSource> s1 = std::make_shared<VoltageSource>("S1", 5, g, n2);
+            c.AddComponent(r1);
+            c.AddComponent(s1);
+            c.ConstructMatrices();
+
+            THEN("nodes and sources know their rows") {
+                CHECK(r1->GetId() == 0);
+                CHECK(s1->GetId() == 1);
+                // unused N0 is removed, rows follow the names
+                CHECK(c.GetNodes().size() == 3);
+                CHECK(c.GetNode(1) == nullptr);
+                CHECK(g->GetIndex() == -1);
+                CHECK(n1->GetIndex() == 0);
+                CHECK(n2->GetIndex() == 1);
+                CHECK(r1->GetIndex() == -1);
+                CHECK(s1->GetIndex() == 2);
+                CHECK(c.GetVoltageSourceIndexes().at("S1") == 2);
+            }
+        }
+
+        WHEN("a node is removed while a component is connected to it") {
+            c.AddComponent(std::make_shared<VoltageSource>("V1", 1, g, n1));
+            c.AddComponent(std::make_shared<Resistor>("R1", 1, n1, n2));
+            c.AddComponent(std::make_shared<Resistor>("R2", 1, n2, g));
+
+            THEN("it stays and the matrices are constructed") {
+                CHECK(!c.RemoveNode("N2"));
+                CHECK(c.RemoveNode("N0"));
+                CHECK(!c.RemoveNode("N0"));
+                c.ConstructMatrices();
+                CHECK(c.GetNode(3) == n2);
+                CHECK(n2->GetIndex() == 1);
+                CHECK(c.GetAMatrix().rows() == 3);
+            }
+        }
+    }
+
+    GIVEN("An empty circuit") {
+
+        Circuit c = Circuit();
+
+        WHEN("more than 100000 nodes are named automatically") {
+            std::shared_ptr<Node> last;
+            for ( int i = 0; i < 100002; i++ ) {
+                last = c.AddNode();
+            }
+
+            THEN("every node gets a new name") {
+                REQUIRE(last != nullptr);
+                CHECK(last->GetName() == "N100001");
+                CHECK(last->GetId() == 100001);
+            }
+        }
+    }
+}
+
+SCENARIO("Structure of arrays element store") {
+    GIVEN("A store with three resistors") {
+
+        ComponentStore store;
+        ComponentHandle r1 = store.Add(RESISTOR, 10, 0, 1);
+        ComponentHandle r2 = store.Add(RESISTOR, 20, 1, 2, "R2");
+        ComponentHandle r3 = store.Add(RESISTOR, 30, 2, 0);
+
+        WHEN("the first one is removed") {
+            CHECK(store.Remove(r1));
+
+            THEN("the last one takes its place and handles stay valid") {
+                CHECK_FALSE(store.Contains(r1));
+                CHECK_FALSE(store.Remove(r1));
+                CHECK(store.Size(RESISTOR) == 2);
+                CHECK(store.GetPosition(r3) == 0);
+                CHECK(store.GetValue(r3) == 30);
+                CHECK(store.GetValue(r2) == 20);
+                CHECK(store.GetName(r2) == "R2");
+                CHECK(store.GetNode(r3, INPUT) == 2);
+                CHECK(store.Get(RESISTOR).values[0] == 30);
+            }
+
+            THEN("a reused slot does not revive the old handle") {
+                ComponentHandle c1 = store.Add(CAPACITOR, 1e-6, 0, 1);
+                CHECK(c1.slot == r1.slot);
+                CHECK(c1 != r1);
+                CHECK_FALSE(store.Contains(r1));
+                CHECK(store.GetType(c1) == CAPACITOR);
+                CHECK(store.Size() == 3);
+            }
+        }
+
+        WHEN("the store is cleared and a component added") {
+            store.Clear();
+            ComponentHandle c1 = store.Add(CAPACITOR, 1e-6, 0, 1);
+
+            THEN("the old handles stay invalid") {
+                CHECK(c1.slot == r1.slot);
+                CHECK_FALSE(store.Contains(r1));
+                CHECK_FALSE(store.Contains(r2));
+                CHECK_FALSE(store.Remove(r1));
+                CHECK(store.Contains(c1));
+                CHECK(store.Size() == 1);
+            }
+        }
+    }
+
+    GIVEN("The same circuit built from components and from elements") {
+
+        Circuit objects = Circuit();
+        Circuit elements = Circuit();
+
+        for ( Circuit* c : { &objects, &elements } ) {
+            std::shared_ptr<Node> g = c->AddNode("0");
+            std::shared_ptr<Node> n1 = c->AddNode("N1");
+            std::shared_ptr<Node> n2 = c->AddNode("N2");
+            std::shared_ptr<Node> n3 = c->AddNode("N3");
+            if ( c == &objects ) {
+                c->AddComponent(std::make_shared<VoltageSource>("S1", 12, g, n1));
+                c->AddComponent(std::make_shared<Resistor>("R1", 100, n1, n2));
+                c->AddComponent(std::make_shared<Inductor>("L1", 0.005, n2, n3));
+                c->AddComponent(std::make_shared<Capacitor>("C1", 0.00002, n3, g));
+                c->AddComponent(std::make_shared<Resistor>("R2", 50, n3, g));
+                c->AddComponent(std::make_shared<CurrentSource>("I1", 0.1, g, n3));
+            } else {
+                c->AddElement(VOLTAGE_SOURCE, "S1", 12, g, n1);
+                c->AddElement(RESISTOR, "R1", 100, n1, n2);
+                c->AddElement(INDUCTOR, "L1", 0.005, n2, n3);
+                c->AddElement(CAPACITOR, "C1", 0.00002, n3, g);
+                c->AddElement(RESISTOR, "R2", 50, n3, g);
+                c->AddElement(CURRENT_SOURCE, "I1", 0.1, g, n3);
+            }
+        }
+
+        WHEN("constructed for DC and AC") {
+            float omegas[] = { 0, 314.159265359 };
+
+            THEN("the matrices and indexes are the same") {
+                for ( float omega : omegas ) {
+                    objects.SetOmega(omega);
+                    elements.SetOmega(omega);
+                    objects.ConstructMatrices();
+                    elements.ConstructMatrices();
+
+                    CHECK(elements.GetComponents().empty());
+                    CHECK(elements.GetSparseAMatrix().isApprox(objects.GetSparseAMatrix()));
+                    CHECK(elements.GetZMatrix().isApprox(objects.GetZMatrix()));
+                    CHECK(elements.GetCMatrix().isApprox(objects.GetCMatrix()));
+                    CHECK(elements.GetVoltageSourceIndexes() == objects.GetVoltageSourceIndexes());
+                    CHECK(elements.GetInductorIndexes() == objects.GetInductorIndexes());
+                }
+            }
+        }
+    }
+
+    GIVEN("A resistor grid held in the element store") {
+
+        Circuit objects = ResistorGrid(12);
+        Circuit elements = ResistorGrid(12, 1, 1e-3, 1, 0.1, true);
+        objects.ConstructMatrices();
+        elements.ConstructMatrices();
+
+        THEN("it stamps the same G matrix and sources") {
+            CHECK(elements.GetElements().Size() == objects.GetComponents().size());
+            CHECK(elements.GetGMatrix().isApprox(objects.GetGMatrix()));
+            CHECK(elements.GetSourceVector().isApprox(objects.GetSourceVector()));
+        }
+    }
+}
+
+SCENARIO("Stamp kernels") {
+
+    GIVEN("An empty stamp context") {
+
+        VectorXd s = VectorXd::Zero(3);
+        StampContext context;
+        context.s = &s;
+
+        WHEN("a resistor is stamped between a node and ground") {
+            StampKernel<RESISTOR>::Apply(context, 0, -1, -1, 4);
+
+            THEN("only the diagonal entry of the node is added") {
+                REQUIRE(context.g.size() == 1);
+                CHECK(context.g[0].row() == 0);
+                CHECK(context.g[0].col() == 0);
+                CHECK(context.g[0].value() == doctest::Approx(0.25));
+                CHECK(context.c[0].value() == 0);
+                CHECK(context.gamma[0].value() == 0);
+            }
+        }
+
+        WHEN("a voltage source is stamped with its branch row") {
+            StampKernel<VOLTAGE_SOURCE>::Apply(context, 0, 1, 2, 5);
+
+            THEN("it adds the +-1 entries and its value to the branch row") {
+                SparseMatrix<double> G(3, 3);
+                G.setFromTriplets(context.g.begin(), context.g.end());
+                CHECK(G.coeff(2, 0) == 1);
+                CHECK(G.coeff(0, 2) == 1);
+                CHECK(G.coeff(2, 1) == -1);
+                CHECK(G.coeff(1, 2) == -1);
+                CHECK(s(2) == 5);
+            }
+        }
+
+        WHEN("a current source is stamped through the runtime dispatch") {
+            StampComponent(context, CURRENT_SOURCE, 0, 1, -1, 0.5);
+
+            THEN("the current enters the output and leaves the input") {
+                CHECK(context.g.empty());
+                CHECK(s(0) == doctest::Approx(0.5));
+                CHECK(s(1) == doctest::Approx(-0.5));
+            }
+        }
+    }
+}
+
+SCENARIO("Updating values through the assembly plan") {
+    GIVEN("A constructed circuit with components and elements") {
+
+        Circuit c = Circuit();
+
+        auto n1 = c.AddNode("N001");
+        auto n2 = c.AddNode("N002");
+        auto n3 = c.AddNode("N003");
+        auto g = c.AddNode("0");
+
+        auto r1 = std::make_shared<Resistor>("R1", 0.5, n1, n2);
+        auto c1 = std::make_shared<Capacitor>("C1", 0.005, n3, g);
+        auto v1 = std::make_shared<VoltageSource>("V1", 4, g, n1);
+        c.AddComponent(r1);
+        c.AddComponent(c1);
+        c.AddComponent(v1);
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.001, n2, n3));
+        ComponentHandle r2 = c.AddElement(RESISTOR, "R2", 2, n3, g);
+        ComponentHandle i1 = c.AddElement(CURRENT_SOURCE, "I1", 0.1, g, n2);
+        c.SetOmega( 314 );
+        c.ConstructMatrices();
+
+        SparseMatrix<cd> A = c.GetSparseAMatrix();
+
+        WHEN("values change and the circuit is updated") {
+            r1->SetValue(3);
+            c1->SetValue(0.02);
+            v1->SetValue(7);
+            c.GetElements().SetValue(r2, 5);
+            c.GetElements().SetValue(i1, 0.3);
+            c.SetOmega( 1000 );
+            c.UpdateValues();
+
+            Circuit reference = c;
+            reference.ConstructMatrices();
+
+            THEN("the matrices match a full construction") {
+                CHECK(c.GetSparseAMatrix().isApprox(reference.GetSparseAMatrix()));
+                CHECK(c.GetZMatrix().isApprox(reference.GetZMatrix()));
+                CHECK(c.GetCMatrix().isApprox(reference.GetCMatrix()));
+                CHECK(c.GetSourceVector().isApprox(reference.GetSourceVector()));
+                CHECK(!c.GetSparseAMatrix().isApprox(A));
+            }
+        }
+
+        WHEN("a component is added before the update") {
+            c.AddComponent(std::make_shared<Resistor>("R3", 1, n1, n3));
+            c.UpdateValues();
+
+            Circuit reference = c;
+            reference.ConstructMatrices();
+
+            THEN("it falls back to a full construction") {
+                CHECK(c.GetSparseAMatrix().isApprox(reference.GetSparseAMatrix()));
+            }
+        }
+
+        WHEN("the circuit moves to DC") {
+            c.SetOmega( 0 );
+            c.UpdateValues();
+
+            THEN("the inductor gets its DC row") {
+                CHECK(c.GetInductorIndexes().count("L1") == 1);
+                CHECK(c.IsReal());
+            }
+        }
+    }
+}
+
+SCENARIO("Restamping edited components") {
+    GIVEN("A circuit constructed for DC and AC") {
+
+        auto build = [](Circuit& c, float omega, float r1_value, float v1_value) {
+            auto n1 = c.AddNode("N001");
+            auto n2 = c.AddNode("N002");
+            auto n3 = c.AddNode("N003");
+            auto g = c.AddNode("0");
+            c.AddComponent(std::make_shared<Resistor>("R1", r1_value, n1, n2));
+            c.AddComponent(std::make_shared<Resistor>("R2", 4, n2, n3));
+            c.AddComponent(std::make_shared<Capacitor>("C1", 0.01, n3, g));
+            c.AddComponent(std::make_shared<Inductor>("L1", 0.002, n2, g));
+            c.AddComponent(std::make_shared<VoltageSource>("V1", v1_value, g, n1));
+            c.SetOmega(omega);
+            c.ConstructMatrices();
+        };
+        float omegas[] = { 0, 314 };
+
+        WHEN("values are edited") {
+
+            THEN("the result is that of a full construction") {
+                for ( float omega : omegas ) {
+                    Circuit c = Circuit();
+                    build(c, omega, 2, 5);
+                    c.GetComponents().front()->SetValue(8);
+                    c.GetComponents().back()->SetValue(3);
+                    c.ConstructMatrices();
+
+                    Circuit reference = Circuit();
+                    build(reference, omega, 8, 3);
+
+                    CHECK(c.GetAMatrix().isApprox(reference.GetAMatrix()));
+                    CHECK(c.GetSparseAMatrix().isApprox(reference.GetSparseAMatrix()));
+                    CHECK(c.GetZMatrix().isApprox(reference.GetZMatrix()));
+                }
+            }
+        }
+
+        WHEN("a terminal is reconnected") {
+
+            THEN("the circuit is built again") {
+                for ( float omega : omegas ) {
+                    Circuit c = Circuit();
+                    build(c, omega, 2, 5);
+                    c.GetComponents().front()->ConnectNodeToTerminal(c.GetNodes()["N003"], INPUT);
+                    c.ConstructMatrices();
+
+                    Circuit reference = Circuit();
+                    build(reference, omega, 2, 5);
+                    reference.GetComponents().front()->ConnectNodeToTerminal(reference.GetNodes()["N003"], INPUT);
+                    reference.ConstructMatrices();
+
+                    CHECK(c.GetAMatrix().isApprox(reference.GetAMatrix()));
+                    CHECK(c.GetZMatrix().isApprox(reference.GetZMatrix()));
+                }
+            }
+        }
+
+        WHEN("a node is grounded") {
+
+            THEN("it loses its row") {
+                for ( float omega : omegas ) {
+                    Circuit c = Circuit();
+                    build(c, omega, 2, 5);
+                    int rows = c.GetAMatrix().rows();
+                    c.GetNodes()["N003"]->SetNodeType(GROUND);
+                    c.ConstructMatrices();
+
+                    CHECK(c.GetNodeIndexes().count("N003") == 0);
+                    CHECK(c.GetAMatrix().rows() == rows - 1);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Islands") {
+    GIVEN("Two parts of a circuit that only share ground") {
+
+        Circuit c = Circuit();
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> a1 = c.AddNode("A1");
+        std::shared_ptr<Node> a2 = c.AddNode("A2");
+        std::shared_ptr<Node> b1 = c.AddNode("B1");
+        std::shared_ptr<Node> b2 = c.AddNode("B2");
+
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 5, g, a1));
+        c.AddComponent(std::make_shared<Resistor>("R1", 10, a1, a2));
+        c.AddComponent(std::make_shared<Resistor>("R2", 10, a2, g));
+        c.AddElement(INDUCTOR, "L1", 0.001, b1, b2);
+        c.AddElement(RESISTOR, "R3", 10, b2, g);
+        c.AddComponent(std::make_shared<CurrentSource>("I1", 1, g, b1));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.001, a2, b2));
+
+        WHEN("constructed for DC") {
+            c.ConstructMatrices();
+            const std::vector<int>& islands = c.GetIslands();
+            const std::map<std::string, int>& rows = c.GetNodeIndexes();
+
+            THEN("every row belongs to the island of its nodes") {
+                CHECK(c.GetIslandCount() == 2);
+                CHECK(islands.size() == c.GetZMatrix().rows());
+                CHECK(islands[rows.at("A1")] == islands[rows.at("A2")]);
+                CHECK(islands[rows.at("B1")] == islands[rows.at("B2")]);
+                CHECK(islands[rows.at("A1")] != islands[rows.at("B1")]);
+                CHECK(islands[c.GetVoltageSourceIndexes().at("S1")] == islands[rows.at("A1")]);
+                CHECK(islands[c.GetInductorIndexes().at("L1")] == islands[rows.at("B1")]);
+                CHECK(c.GetFloatingNodes().empty());
+                CHECK(c.Solveable());
+            }
+        }
+
+        WHEN("constructed for AC") {
+            c.SetOmega(100);
+            c.ConstructMatrices();
+
+            THEN("the capacitor joins the parts") {
+                CHECK(c.GetIslandCount() == 1);
+                CHECK(c.Solveable());
+            }
+        }
+
+        WHEN("a part has no path to ground") {
+            std::shared_ptr<Node> f2 = c.AddNode("F2");
+            std::shared_ptr<Node> f3 = c.AddNode("F3");
+            c.AddComponent(std::make_shared<Resistor>("R4", 10, f2, f3));
+            c.AddComponent(std::make_shared<CurrentSource>("I2", 1, g, f2));
+            c.ConstructMatrices();
+
+            THEN("its nodes are reported up front") {
+                CHECK(c.GetIslandCount() == 3);
+                CHECK(c.GetFloatingNodes() == std::vector<std::string>({"F2", "F3"}));
+                CHECK(!c.Solveable());
+            }
+        }
+    }
+}
+
+SCENARIO("Topological reduction") {
+    GIVEN("A DC circuit with inductor chains and a grounded voltage source") {
+
+        Circuit c = Circuit();
+        c.SetTopologyReduction(true);
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> a = c.AddNode("A");
+        std::shared_ptr<Node> b = c.AddNode("B");
+        std::shared_ptr<Node> d = c.AddNode("D");
+        std::shared_ptr<Node> e = c.AddNode("E");
+        std::shared_ptr<Node> f = c.AddNode("F");
+
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 10, g, a));
+        c.AddComponent(std::make_shared<Resistor>("R1", 10, a, b));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.001, b, d));
+        c.AddElement(INDUCTOR, "L2", 0.001, d, e);
+        c.AddComponent(std::make_shared<Resistor>("R2", 10, e, g));
+        c.AddComponent(std::make_shared<Inductor>("L3", 0.001, f, g));
+        c.AddComponent(std::make_shared<Resistor>("R3", 5, a, f));
+
+        WHEN("constructed for DC") {
+            c.ConstructMatrices();
+            const std::map<std::string, int>& rows = c.GetNodeIndexes();
+
+            THEN("only the row of the shorted chain is left") {
+                CHECK(c.IsReduced());
+                CHECK(rows.size() == 5);
+                CHECK(c.GetGMatrix().rows() == 9);
+                CHECK(c.GetReducedDimension() == 1);
+                CHECK(c.GetReducedAMatrix().rows() == 1);
+                CHECK(c.GetReducedZMatrix().rows() == 1);
+                CHECK(c.GetReducedAMatrix().coeff(0, 0) == doctest::Approx(0.2));
+                CHECK(c.GetReducedZMatrix()(0) == doctest::Approx(1));
+                CHECK(c.GetRealSparseAMatrix().rows() == 9);
+                CHECK(c.GetZMatrix().rows() == 9);
+                CHECK(c.GetIslands().size() == 1);
+                CHECK(c.GetReducedMatrixProperties().definite);
+                CHECK(!c.GetMatrixProperties().definite);
+            }
+
+            THEN("the expanded solution has every voltage and current") {
+                VectorXd x;
+                c.ExpandSolution(VectorXd::Constant(1, 5), x);
+                REQUIRE(x.rows() == 9);
+                CHECK(x(rows.at("A")) == doctest::Approx(10));
+                CHECK(x(rows.at("B")) == doctest::Approx(5));
+                CHECK(x(rows.at("E")) == doctest::Approx(5));
+                CHECK(x(rows.at("F")) == doctest::Approx(0));
+                CHECK(std::abs(x(c.GetInductorIndexes().at("L1"))) == doctest::Approx(0.5));
+                CHECK(std::abs(x(c.GetInductorIndexes().at("L2"))) == doctest::Approx(0.5));
+                CHECK(std::abs(x(c.GetInductorIndexes().at("L3"))) == doctest::Approx(2));
+                CHECK(std::abs(x(c.GetVoltageSourceIndexes().at("S1"))) == doctest::Approx(2.5));
+
+                VectorXd residual = c.GetGMatrix() * x - c.GetSourceVector();
+                CHECK(residual.norm() < 1e-9);
+            }
+        }
+
+        WHEN("the source is edited") {
+            c.ConstructMatrices();
+            for ( auto const& component : c.GetComponents() ) {
+                if ( component->GetName() == "S1" ) {
+                    component->SetValue(20);
+                }
+            }
+            c.ConstructMatrices();
+
+            THEN("the substituted voltage follows it") {
+                CHECK(c.IsReduced());
+                CHECK(c.GetReducedZMatrix()(0) == doctest::Approx(2));
+            }
+        }
+
+        WHEN("constructed for AC") {
+            c.SetOmega(100);
+            c.ConstructMatrices();
+
+            THEN("nothing is reduced") {
+                CHECK(!c.IsReduced());
+                CHECK(c.GetReducedDimension() == 6);
+            }
+        }
+    }
+
+    GIVEN("A DC circuit that would reduce to nothing") {
+
+        Circuit c = Circuit();
+        c.SetTopologyReduction(true);
+
+        std::shared_ptr<Node> g = c.AddNode("0");
+        std::shared_ptr<Node> a = c.AddNode("A");
+        std::shared_ptr<Resistor> r1 = std::make_shared<Resistor>("R1", 10, a, g);
+        c.AddComponent(std::make_shared<VoltageSource>("S1", 10, g, a));
+        c.AddComponent(r1);
+        c.ConstructMatrices();
+
+        WHEN("a value is edited") {
+            r1->SetValue(4);
+            c.ConstructMatrices();
+
+            THEN("it is restamped on the full system") {
+                CHECK(!c.IsReduced());
+                CHECK(c.GetGMatrix().coeff(0, 0) == doctest::Approx(0.25));
+            }
+        }
+    }
+}
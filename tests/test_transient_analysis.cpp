@@ -0,0 +1,326 @@
+#include <string>
+#include <cmath>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include "doctest.h"
+#include "transient_analysis.hpp"
+#include "circuit.hpp"
+#include "resistor.hpp"
+#include "inductor.hpp"
+#include "capacitor.hpp"
+#include "voltage_source.hpp"
+#include "node.hpp"
+#include "waveform.hpp"
+#include "Eigen/Dense"
+
+SCENARIO("Transient analysis of a RC circuit") {
+    GIVEN("Capacitor charged through a resistor") {
+
+        Circuit c = Circuit();
+
+        auto g = c.AddNode("0");
+        auto n1 = c.AddNode("N1");
+        auto n2 = c.AddNode("N2");
+
+        c.AddComponent(std::make_shared<VoltageSource>("V1", 1, g, n1));
+        c.AddComponent(std::make_shared<Resistor>("R1", 1000, n1, n2));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.000001, n2, g));
+
+        WHEN("integrated with the trapezoidal rule") {
+            TransientAnalysis tran = TransientAnalysis(0.00001, 0.005, TRAPEZOIDAL);
+
+            float v_tau = 0;
+            float v_end = 0;
+            bool ok = tran.Run(c, [&](float t, const VectorXf& x) {
+                int idx = tran.GetNodeIndexes().at("N2");
+                if ( std::abs(t - 0.001) < 0.000005 ) v_tau = x(idx);
+                v_end = x(idx);
+            });
+
+            THEN("the capacitor voltage follows 1 - exp(-t / RC)") {
+                CHECK(ok);
+                CHECK(v_tau == doctest::Approx(1 - std::exp(-1.0)).epsilon(0.001));
+                CHECK(v_end == doctest::Approx(1 - std::exp(-5.0)).epsilon(0.001));
+            }
+
+            THEN("the matrix is factored only once") {
+                CHECK(tran.GetStepCount() == 500);
+                CHECK(tran.GetFactorizationCount() == 1);
+            }
+        }
+
+        WHEN("integrated with backward Euler") {
+            TransientAnalysis tran = TransientAnalysis(0.00001, 0.001, BACKWARD_EULER);
+
+            float v_tau = 0;
+            tran.Run(c, [&](float t, const VectorXf& x) {
+                v_tau = x(tran.GetNodeIndexes().at("N2"));
+            });
+
+            THEN("the result is first order accurate") {
+                CHECK(v_tau == doctest::Approx(1 - std::exp(-1.0)).epsilon(0.01));
+            }
+        }
+
+        WHEN("recorded into a result store") {
+            TransientAnalysis tran = TransientAnalysis(0.00001, 0.005, TRAPEZOIDAL);
+            TransientResults results;
+            bool ok = tran.Run(c, results);
+
+            THEN("every step is a column at its time") {
+                CHECK(ok);
+                CHECK(results.GetColumns() == tran.GetStepCount() + 1);
+                CHECK(results.GetPoints().back() == doctest::Approx(0.005));
+                TransientResults::Trace v2 = results.GetTrace(results.GetIndex("N2"));
+                CHECK(v2(0) == 0);
+                CHECK(v2(v2.size() - 1) == doctest::Approx(1 - std::exp(-5.0)).epsilon(0.001));
+                CHECK(results.GetType(results.GetIndex("V1")) == VOLTAGE_SOURCE_CURRENT);
+                CHECK(results.GetVoltage(n2->GetId(), v2.size() - 1) == v2(v2.size() - 1));
+                CHECK(results.GetVoltage(g->GetId(), 1) == 0);
+            }
+
+            THEN("the resistor and capacitor currents are kept by component id") {
+                int r1 = results.GetComponentId("R1");
+                int c1 = results.GetComponentId("C1");
+                CHECK(results.GetComponentCount() == 3);
+                CHECK(results.GetComponentId("V1") == 0);
+                CHECK(results.GetCurrent(results.GetComponentId("V1"), 10) == 0);
+                // the same current flows through both
+                CHECK(results.GetCurrentTrace(r1).isApprox(results.GetCurrentTrace(c1), 1e-3));
+                CHECK(results.GetCurrent(c1, 100) == doctest::Approx(std::exp(-1.0) / 1000).epsilon(0.001));
+            }
+        }
+
+        WHEN("started from the operating point of a circuit with topology reduction") {
+            c.SetTopologyReduction(true);
+            TransientAnalysis tran = TransientAnalysis(0.0001, 0.001);
+            tran.SetUseOperatingPoint(true);
+
+            float v_start = 0;
+            float v_end = 0;
+            bool ok = tran.Run(c, [&](float t, const VectorXf& x) {
+                float v = x(tran.GetNodeIndexes().at("N2"));
+                if ( t == 0 ) v_start = v;
+                v_end = v;
+            });
+
+            THEN("the full system is solved for the operating point") {
+                CHECK(ok);
+                CHECK(c.IsReduced());
+                CHECK(!c.GetMatrixProperties().definite);
+                CHECK(v_start == doctest::Approx(1));
+                CHECK(v_end == doctest::Approx(1));
+            }
+        }
+
+        WHEN("started from the operating point") {
+            TransientAnalysis tran = TransientAnalysis(0.0001, 0.001);
+            tran.SetUseOperatingPoint(true);
+
+            std::stringstream out;
+            tran.Run(c, out);
+
+            THEN("the circuit stays at its DC state") {
+                std::string header;
+                std::getline(out, header);
+                CHECK(header == "t N1[V] N2[V] V1[A]");
+                float t, v1, v2, i;
+                out >> t >> v1 >> v2 >> i;
+                CHECK(v2 == doctest::Approx(1));
+            }
+        }
+    }
+}
+
+SCENARIO("Transient analysis of a node connected only through capacitors") {
+    GIVEN("Two capacitors in series charged through a resistor") {
+
+        Circuit c = Circuit();
+
+        auto g = c.AddNode("0");
+        auto n1 = c.AddNode("N1");
+        auto n2 = c.AddNode("N2");
+        auto n3 = c.AddNode("N3");
+
+        c.AddComponent(std::make_shared<VoltageSource>("V1", 1, g, n1));
+        c.AddComponent(std::make_shared<Resistor>("R1", 1000, n1, n3));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.000001, n3, n2));
+        c.AddComponent(std::make_shared<Capacitor>("C2", 0.000001, n2, g));
+
+        WHEN("integrated with backward Euler") {
+            TransientAnalysis tran = TransientAnalysis(0.0001, 0.01, BACKWARD_EULER);
+
+            int points = 0;
+            float v_end = 0;
+            bool ok = tran.Run(c, [&](float t, const VectorXf& x) {
+                points++;
+                v_end = x(tran.GetNodeIndexes().at("N2"));
+            });
+
+            THEN("the node between the capacitors is solved and divides the supply") {
+                CHECK(ok);
+                CHECK(points == 101);
+                CHECK(v_end == doctest::Approx(0.5).epsilon(0.001));
+            }
+        }
+
+        WHEN("started from the DC operating point") {
+            TransientAnalysis tran = TransientAnalysis(0.0001, 0.01, BACKWARD_EULER);
+            tran.SetUseOperatingPoint(true);
+
+            THEN("the node has no DC path to ground") {
+                CHECK(!tran.Run(c, [](float t, const VectorXf& x) {}));
+                CHECK(c.GetFloatingNodes() == std::vector<std::string>{"N2"});
+                CHECK(c.GetTransientFloatingNodes().empty());
+            }
+        }
+    }
+}
+
+SCENARIO("Transient analysis of a RL circuit") {
+    GIVEN("Inductor current building up through a resistor") {
+
+        Circuit c = Circuit();
+
+        auto g = c.AddNode("0");
+        auto n1 = c.AddNode("N1");
+        auto n2 = c.AddNode("N2");
+
+        c.AddComponent(std::make_shared<VoltageSource>("V1", 1, g, n1));
+        c.AddComponent(std::make_shared<Resistor>("R1", 1, n1, n2));
+        c.AddComponent(std::make_shared<Inductor>("L1", 0.001, n2, g));
+
+        WHEN("integrated with the trapezoidal rule") {
+            TransientAnalysis tran = TransientAnalysis(0.00001, 0.001);
+
+            float i_tau = 0;
+            tran.Run(c, [&](float t, const VectorXf& x) {
+                i_tau = x(tran.GetInductorIndexes().at("L1"));
+            });
+
+            THEN("the inductor current follows 1 - exp(-tR / L)") {
+                CHECK(std::abs(i_tau) == doctest::Approx(1 - std::exp(-1.0)).epsilon(0.001));
+            }
+        }
+    }
+}
+
+SCENARIO("Source waveforms") {
+    GIVEN("A periodic pulse") {
+        PulseWaveform pulse = PulseWaveform(0, 5, 1, 0.5, 0.5, 2, 10);
+
+        THEN("values follow the pulse shape") {
+            CHECK(pulse.GetValue(0.5) == doctest::Approx(0));
+            CHECK(pulse.GetValue(1.25) == doctest::Approx(2.5));
+            CHECK(pulse.GetValue(2.5) == doctest::Approx(5));
+            CHECK(pulse.GetValue(3.75) == doctest::Approx(2.5));
+            CHECK(pulse.GetValue(12.5) == doctest::Approx(5));
+        }
+
+        THEN("every corner is a breakpoint") {
+            std::vector<float> b = pulse.GetBreakpoints(12);
+            std::vector<float> e = { 1, 1.5, 3.5, 4, 11, 11.5 };
+            CHECK(b == e);
+        }
+    }
+
+    GIVEN("A piecewise linear waveform") {
+        PWLWaveform pwl = PWLWaveform({ {0, 0}, {1, 2}, {3, 0} });
+
+        THEN("values are interpolated between the points") {
+            CHECK(pwl.GetValue(0.5) == doctest::Approx(1));
+            CHECK(pwl.GetValue(2) == doctest::Approx(1));
+            CHECK(pwl.GetValue(5) == doctest::Approx(0));
+            CHECK(pwl.GetBreakpoints(2).size() == 1);
+        }
+    }
+
+    GIVEN("A delayed sine") {
+        SineWaveform sine = SineWaveform(1, 2, 50, 0.01);
+
+        THEN("it starts after the delay") {
+            CHECK(sine.GetValue(0.005) == doctest::Approx(1));
+            CHECK(sine.GetValue(0.015) == doctest::Approx(3));
+            CHECK(sine.GetBreakpoints(1).size() == 1);
+        }
+    }
+}
+
+SCENARIO("Adaptive transient analysis") {
+    GIVEN("RC circuit driven by a pulse") {
+
+        Circuit c = Circuit();
+
+        auto g = c.AddNode("0");
+        auto n1 = c.AddNode("N1");
+        auto n2 = c.AddNode("N2");
+
+        auto v1 = std::make_shared<VoltageSource>("V1", 0, g, n1);
+        v1->SetWaveform(std::make_shared<PulseWaveform>(0, 1, 0.0001, 0.000001, 0.000001, 0.001));
+        c.AddComponent(v1);
+        c.AddComponent(std::make_shared<Resistor>("R1", 10, n1, n2));
+        c.AddComponent(std::make_shared<Capacitor>("C1", 0.00001, n2, g));
+
+        WHEN("integrated with adaptive steps") {
+            TransientAnalysis tran = TransientAnalysis(0.0001, 0.002);
+            tran.SetAdaptive(true);
+
+            std::vector<float> times;
+            float max_error = 0;
+            bool ok = tran.Run(c, [&](float t, const VectorXf& x) {
+                times.push_back(t);
+                float v = x(tran.GetNodeIndexes().at("N2"));
+                float rising = 0.000101;
+                if ( t > rising + 0.000005 && t < 0.0011 ) {
+                    float e = 1 - std::exp(-(t - rising) / 0.0001);
+                    max_error = std::max(max_error, std::abs(v - e));
+                }
+            });
+
+            THEN("steps land exactly on the breakpoints") {
+                CHECK(ok);
+                CHECK(std::find(times.begin(), times.end(), 0.0001f) != times.end());
+                CHECK(std::find(times.begin(), times.end(), 0.001101f) != times.end());
+                CHECK(times.back() == doctest::Approx(0.002));
+            }
+
+            THEN("the response is accurate with far fewer solves than a fixed step") {
+                CHECK(max_error < 0.01);
+                CHECK(tran.GetSolveCount() < 400);
+                CHECK(tran.GetFactorizationCount() < tran.GetStepCount() / 4);
+            }
+        }
+
+        WHEN("compared with fixed steps against the exact response to the ramp") {
+            // error on the rising edge and the settling after it
+            auto max_error = [&](TransientAnalysis& tran) {
+                const double tau = 0.0001, t0 = 0.0001, t1 = 0.000101;
+                float error = 0;
+                tran.Run(c, [&](float t, const VectorXf& x) {
+                    if ( t <= t1 || t >= 0.0011 ) return;
+                    double e = 1 - tau / (t1 - t0) * (std::exp(-(t - t1) / tau) - std::exp(-(t - t0) / tau));
+                    error = std::max(error, float(std::abs(x(tran.GetNodeIndexes().at("N2")) - e)));
+                });
+                return error;
+            };
+
+            TransientAnalysis adaptive = TransientAnalysis(0.0001, 0.002);
+            adaptive.SetAdaptive(true);
+            float adaptive_error = max_error(adaptive);
+            // the coarsest fixed step that is as accurate, and twice that step
+            TransientAnalysis fine = TransientAnalysis(0.000001, 0.002);
+            float fine_error = max_error(fine);
+            TransientAnalysis coarse = TransientAnalysis(0.000002, 0.002);
+            float coarse_error = max_error(coarse);
+
+            THEN("the adaptive steps need over ten times fewer solves at the same accuracy") {
+                CHECK(fine_error < adaptive_error);
+                CHECK(coarse_error > adaptive_error);
+                CHECK(adaptive.GetSolveCount() * 10 < fine.GetSolveCount());
+                CHECK(adaptive.GetSolveCount() * 5 < coarse.GetSolveCount());
+            }
+        }
+    }
+}